@@ -12,8 +12,9 @@ using namespace std;
 
 namespace aprs {
 
-    APRS_IS::APRS_IS(const std::string &callsign, const std::string &passCode, const std::string &filter) :
-            local_socket("cwop.aprs2.net", "14580", true) {
+    APRS_IS::APRS_IS(const std::string &callsign, const std::string &passCode, const std::string &filter,
+                     const std::string &server, const std::string &port) :
+            local_socket(server, port, true) {
         mCallSign = callsign;
         mPassCode = passCode;
         mFilter = filter;
@@ -30,14 +31,23 @@ namespace aprs {
                 }
                 switch (read(fd(), buf, 1)) {
                     case -1:
-                        exit(1);
+                        cerr << "Read: " << strerror(errno) << '\n';
+                        [[fallthrough]];
+                    case 0:
+                        // The server closed the connection, or it was shut down to stop reading.
+                        mPacket.clear();
+                        return mPacket;
                     default:
                         if (buf[0] != '\r')
                             stringBuf << buf[0];
                         endOfLine = buf[0] == '\n';
                 }
+            } else if (n < 0 && errno == EINTR && stringBuf.tellp() > 0) {
+                // Interrupted by a signal part way through a line, finish it.
+                continue;
             } else if (n != 0) {
-                cerr << "Select: " << n << '\n';
+                if (n != -1 || errno != EINTR)
+                    cerr << "Select: " << n << '\n';
                 mPacket.clear();
                 return mPacket;
             }
@@ -50,21 +60,21 @@ namespace aprs {
     }
 
     bool APRS_IS::openConnection() {
-        while (!mGoodServer) {
-            if (connect(AF_INET6, AF_INET, AF_UNSPEC) < 0) {
-                cerr << "Connection failed.\n";
-                return false;
-            }
+        if (connect(AF_INET6, AF_INET, AF_UNSPEC) < 0) {
+            cerr << "Connection failed.\n";
+            return false;
+        }
 
-            mPeerName = getPeerName();
-            getPacket();
-            if (mGoodServer = !prefix("# javAPRSSrvr 4.3.0b22") &&
-                              !prefix("# javAPRSSrvr 4.3.0b17") &&
-//                              !prefix("# javAPRSSrvr 3.15b08") &&
-                              !prefix("# javAPRSSrvr 4.2.0b09"); !mGoodServer) {
-                cerr << "Reject " << mPeerName << " version " << mPacket;
-                close();
-            }
+        // A rejected server is left for the caller to retry, possibly with another server.
+        mPeerName = getPeerName();
+        getPacket();
+        if (mGoodServer = !prefix("# javAPRSSrvr 4.3.0b22") &&
+                          !prefix("# javAPRSSrvr 4.3.0b17") &&
+//                          !prefix("# javAPRSSrvr 3.15b08") &&
+                          !prefix("# javAPRSSrvr 4.2.0b09"); !mGoodServer) {
+            cerr << "Reject " << mPeerName << " version " << mPacket;
+            close();
+            return false;
         }
 
         cerr << "Accept " << mPeerName << " version " << mPacket;
@@ -115,85 +125,276 @@ namespace aprs {
         return std::nullopt;
     }
 
-    std::unique_ptr<APRS_Packet> APRS_IS::decode() {
-        auto name = stringTerminateBy('>');
-        positionAfter(':');
-        while (p0 < mPacket.length() && p0 != std::string::npos) {
-            auto descriminator = decodeCharAtIndex();
-            switch (descriminator) {
-                case '!':
-                case '=':
-                case '@':
-                case '/': {
-                    auto wxReport = std::make_unique<APRS_WX_Report>();
-                    wxReport->mName = name;
-
-                    if (descriminator == '@' || descriminator == '/')
-                        wxReport->mDateTime = decodeString(7);
-
-                    if (auto res = decodeCoordinate(CoordinateType::LatitudeDDMMsss); res.has_value()) {
-                        wxReport->mLat = res.value();
-                    } else {
-                        wxReport->mPacketStatus = PacketStatus::ErrorLatitude;
-                        return wxReport;
-                    }
-
-                    wxReport->mSymTableId = decodeCharAtIndex();
-
-                    if (auto res = decodeCoordinate(CoordinateType::LongitudeDDMMsss); res.has_value()) {
-                        wxReport->mLon = res.value();
-                    } else {
-                        wxReport->mPacketStatus = PacketStatus::ErrorLongitude;
-                        return wxReport;
-                    }
-
-                    wxReport->mSymCode = decodeCharAtIndex();
-
-                    wxReport->decodeWeatherValue(*this, WxSym::WindDirection);
-                    ++p0;
-                    wxReport->decodeWeatherValue(*this, WxSym::WindSpeed);
-
-                    bool inWx = true;
-                    while (inWx && p0 < mPacket.length()) {
-                        auto flag = decodeCharAtIndex();
-                        try {
-                            if (auto found = find_if(WeatherItemList.begin(), WeatherItemList.end(), [flag](auto item){
-                                    return item.wxFlag == flag;
-                            } ); found != WeatherItemList.end()) {
-                                wxReport->decodeWeatherValue(*this, found->wxSym, flag, found->factor);
-                            } else {
-                                inWx = false;
-                            }
-                        } catch (const WeatherValueError &weatherValueError) {
-                            cerr << "Weather value decoding error: " << weatherValueError.what()
-                                 << " Index: " << p0 << '\n'
-                                 << '\t' << mPacket << '\n';
-                            inWx = false;
-                        }
-                    }
-                    --p0;
-
-                    wxReport->setBearingDistance(mQthPosition);
-                    if (mRadius.has_value() && wxReport->mDistance.has_value()) {
-                        double hann = sin(
-                                (M_PI * (mRadius.value() - wxReport->mDistance.value())) / (mRadius.value() * 2.));
-                        wxReport->mHannValue = hann * hann;
-                    }
-
-                    wxReport->mPacketStatus = PacketStatus::WxPacket;
-                    return wxReport;
+    std::optional<double> APRS_IS::decodeBase91(std::size_t length) {
+        if (p0 + length > mPacket.length())
+            return std::nullopt;
+
+        double value = 0.;
+        for (std::size_t i = 0; i < length; ++i) {
+            auto c = decodeCharAtIndex();
+            if (c < '!' || c > '{')
+                return std::nullopt;
+            value = value * 91. + static_cast<double>(c - '!');
+        }
+        return value;
+    }
+
+    void APRS_IS::decodeWeatherData(APRS_WX_Report &wxReport) {
+        bool inWx = true;
+        while (inWx && p0 < mPacket.length()) {
+            auto flag = decodeCharAtIndex();
+            try {
+                if (auto found = find_if(WeatherItemList.begin(), WeatherItemList.end(), [flag](auto item){
+                        return item.wxFlag == flag;
+                } ); found != WeatherItemList.end()) {
+                    wxReport.decodeWeatherValue(*this, found->wxSym, flag, found->factor);
+                } else {
+                    inWx = false;
+                }
+            } catch (const WeatherValueError &weatherValueError) {
+                cerr << "Weather value decoding error: " << weatherValueError.what()
+                     << " Index: " << p0 << '\n'
+                     << '\t' << mPacket << '\n';
+                inWx = false;
+            }
+        }
+        --p0;
+    }
+
+    PacketStatus APRS_IS::positionOnly(DecodedPacket &packet) {
+        APRS_Position position{std::get<APRS_WX_Report>(packet)};
+        position.mPacketStatus = PacketStatus::PositionPacket;
+        return packet.emplace<APRS_Position>(std::move(position)).status();
+    }
+
+    PacketStatus APRS_IS::completeWeather(APRS_WX_Report &wxReport) {
+        if (!(wxReport.mLat.has_value() && wxReport.mLon.has_value())) {
+            wxReport.mPacketStatus = PacketStatus::NoPosition;
+            return wxReport.status();
+        }
+
+        wxReport.setBearingDistance(mQthPosition);
+        if (mRadius.has_value())
+            wxReport.setHannValue(mRadius.value());
+
+        wxReport.mPacketStatus = PacketStatus::WxPacket;
+        return wxReport.status();
+    }
+
+    PacketStatus APRS_IS::decodePosition(const std::string &name, bool timeStamp, DecodedPacket &packet) {
+        auto &wxReport = packet.emplace<APRS_WX_Report>();
+        wxReport.mName = name;
+
+        if (timeStamp)
+            wxReport.mDateTime = decodeString(7);
+
+        bool compressed = p0 < mPacket.length() && !isdigit(charAtIndex()) && charAtIndex() != ' ';
+        if (compressed) {
+            // Compressed format: /YYYYXXXX$csT with base 91 coordinates.
+            wxReport.mSymTableId = decodeCharAtIndex();
+            auto lat = decodeBase91(4);
+            auto lon = decodeBase91(4);
+            if (!lat.has_value()) {
+                wxReport.mPacketStatus = PacketStatus::ErrorLatitude;
+                return wxReport.status();
+            }
+            if (!lon.has_value()) {
+                wxReport.mPacketStatus = PacketStatus::ErrorLongitude;
+                return wxReport.status();
+            }
+            wxReport.mLat = 90. - lat.value() / 380926.;
+            wxReport.mLon = -180. + lon.value() / 190463.;
+            wxReport.mSymCode = decodeCharAtIndex();
+        } else {
+            if (auto res = decodeCoordinate(CoordinateType::LatitudeDDMMsss); res.has_value()) {
+                wxReport.mLat = res.value();
+            } else {
+                wxReport.mPacketStatus = PacketStatus::ErrorLatitude;
+                return wxReport.status();
+            }
+
+            wxReport.mSymTableId = decodeCharAtIndex();
+
+            if (auto res = decodeCoordinate(CoordinateType::LongitudeDDMMsss); res.has_value()) {
+                wxReport.mLon = res.value();
+            } else {
+                wxReport.mPacketStatus = PacketStatus::ErrorLongitude;
+                return wxReport.status();
+            }
+
+            wxReport.mSymCode = decodeCharAtIndex();
+        }
+
+        mContext->mPositions[name] = {wxReport.mLat.value(), wxReport.mLon.value()};
+
+        if (wxReport.mSymCode != '_')
+            return positionOnly(packet);
+
+        if (compressed) {
+            // Wind direction and speed are carried in the course/speed bytes unless they hold
+            // altitude (compression type GGA) or radio range.
+            if (p0 + 3 <= mPacket.length()) {
+                auto c = charAtIndex(), s = charAtIndex(1), t = charAtIndex(2);
+                if (c >= '!' && c < '{' && (((t - '!') >> 3) & 0x3) != 2) {
+                    wxReport.mWeatherValue[static_cast<std::size_t>(WxSym::WindDirection)] =
+                            static_cast<double>(c - '!') * 4.;
+                    wxReport.mWeatherValue[static_cast<std::size_t>(WxSym::WindSpeed)] =
+                            (pow(1.08, static_cast<double>(s - '!')) - 1.) * 1.15078;
                 }
-                    break;
-                case '\n':
-                    return std::make_unique<APRS_Packet>(PacketStatus::DecodingError);
-                default:
-                    cerr << mPacket << "Unhandled discriminator " << '"' << descriminator << '"' << " at " << p0
-                         << '\n';
-                    return std::make_unique<APRS_Packet>(PacketStatus::DecodingError);
+                p0 += 3;
             }
+        } else {
+            wxReport.decodeWeatherValue(*this, WxSym::WindDirection);
+            ++p0;
+            wxReport.decodeWeatherValue(*this, WxSym::WindSpeed);
         }
 
-        return std::make_unique<APRS_Packet>();
+        decodeWeatherData(wxReport);
+        return completeWeather(wxReport);
+    }
+
+    PacketStatus APRS_IS::decodePositionlessWeather(const std::string &name, DecodedPacket &packet) {
+        auto &wxReport = packet.emplace<APRS_WX_Report>();
+        wxReport.mName = name;
+        wxReport.mDateTime = decodeString(8);
+        wxReport.mSymTableId = '/';
+        wxReport.mSymCode = '_';
+        mContext->mPositionless.insert(name);
+
+        decodeWeatherData(wxReport);
+
+        // Place the report at the last position the station sent.
+        if (auto found = mContext->mPositions.find(name); found != mContext->mPositions.end()) {
+            wxReport.mLat = found->second.first;
+            wxReport.mLon = found->second.second;
+        }
+
+        return completeWeather(wxReport);
+    }
+
+    PacketStatus APRS_IS::decodeMicE(const std::string &name, const std::string &destination,
+                                     DecodedPacket &packet) {
+        static constexpr std::size_t MicEInfoLength = 8;
+
+        auto &report = packet.emplace<APRS_WX_Report>();
+        report.mName = name;
+
+        // Latitude digits and the N/S, longitude offset and E/W flags are carried in the destination.
+        if (destination.length() < 6 || p0 + MicEInfoLength > mPacket.length()) {
+            report.mPacketStatus = PacketStatus::DecodingError;
+            return report.status();
+        }
+
+        std::array<int, 6> digit{};
+        std::array<bool, 6> flag{};
+        for (std::size_t i = 0; i < digit.size(); ++i) {
+            auto c = destination[i];
+            if (c >= '0' && c <= '9')
+                digit[i] = c - '0';
+            else if (c >= 'A' && c <= 'J')
+                digit[i] = c - 'A';
+            else if (c >= 'P' && c <= 'Y')
+                digit[i] = c - 'P', flag[i] = true;
+            else if (c == 'Z')
+                flag[i] = true;
+            else if (c != 'K' && c != 'L') {
+                report.mPacketStatus = PacketStatus::ErrorLatitude;
+                return report.status();
+            }
+        }
+
+        double lat = digit[0] * 10 + digit[1] + (digit[2] * 10 + digit[3] + (digit[4] * 10 + digit[5]) / 100.) / 60.;
+        report.mLat = flag[3] ? lat : -lat;
+
+        auto lonDeg = charAtIndex() - 28 + (flag[4] ? 100 : 0);
+        if (lonDeg >= 180 && lonDeg <= 189)
+            lonDeg -= 80;
+        else if (lonDeg >= 190 && lonDeg <= 199)
+            lonDeg -= 190;
+        auto lonMin = charAtIndex(1) - 28;
+        if (lonMin >= 60)
+            lonMin -= 60;
+        auto lonHundredths = charAtIndex(2) - 28;
+        if (lonDeg < 0 || lonDeg > 179 || lonMin < 0 || lonHundredths < 0 || lonHundredths > 99) {
+            report.mPacketStatus = PacketStatus::ErrorLongitude;
+            return report.status();
+        }
+        double lon = lonDeg + (lonMin + lonHundredths / 100.) / 60.;
+        report.mLon = flag[5] ? -lon : lon;
+
+        auto sp = charAtIndex(3) - 28, dc = charAtIndex(4) - 28, se = charAtIndex(5) - 28;
+        report.mSymCode = charAtIndex(6);
+        report.mSymTableId = charAtIndex(7);
+        p0 += MicEInfoLength;
+
+        mContext->mPositions[name] = {report.mLat.value(), report.mLon.value()};
+
+        if (report.mSymCode != '_')
+            return positionOnly(packet);
+
+        // A Mic-E weather station reports wind as course and speed.
+        auto speed = sp * 10 + dc / 10;
+        if (speed >= 800)
+            speed -= 800;
+        auto course = (dc % 10) * 100 + se;
+        if (course >= 400)
+            course -= 400;
+        report.mWeatherValue[static_cast<std::size_t>(WxSym::WindDirection)] = course;
+        report.mWeatherValue[static_cast<std::size_t>(WxSym::WindSpeed)] = speed * 1.15078;
+
+        return completeWeather(report);
+    }
+
+    PacketStatus APRS_IS::decode(DecodedPacket &packet) {
+        try {
+            auto name = stringTerminateBy('>');
+            skip();
+            auto destination = stringTerminateBy(mPacket.find(',', p0) < mPacket.find(':', p0) ? ',' : ':');
+            positionAfter(':');
+            if (p0 == std::string::npos || p0 >= mPacket.length())
+                return packet.emplace<APRS_Packet>(PacketStatus::DecodingError).status();
+
+            return decodeInformation(name, destination, packet);
+        } catch (const std::out_of_range &) {
+            // A truncated packet ran a decoder off the end of the line.
+            return packet.emplace<APRS_Packet>(PacketStatus::DecodingError).status();
+        }
+    }
+
+    PacketStatus APRS_IS::decode(const PacketClassification &classification, DecodedPacket &packet) {
+        try {
+            p0 = classification.info;
+            p1 = std::string::npos;
+            return decodeInformation(std::string{classification.name}, std::string{classification.destination},
+                                     packet);
+        } catch (const std::out_of_range &) {
+            return packet.emplace<APRS_Packet>(PacketStatus::DecodingError).status();
+        }
+    }
+
+    PacketStatus APRS_IS::decodeInformation(const std::string &name, const std::string &destination,
+                                            DecodedPacket &packet) {
+        auto discriminator = decodeCharAtIndex();
+        switch (discriminator) {
+            case '!':
+            case '=':
+                return decodePosition(name, false, packet);
+            case '@':
+            case '/':
+                return decodePosition(name, true, packet);
+            case '_':
+                return decodePositionlessWeather(name, packet);
+            case '`':
+            case '\'':
+            case '\x1c':
+            case '\x1d':
+                return decodeMicE(name, destination, packet);
+            case '\n':
+                return packet.emplace<APRS_Packet>(PacketStatus::DecodingError).status();
+            default:
+                ++mContext->mUnhandled[discriminator];
+                return packet.emplace<APRS_Packet>(PacketStatus::Unsupported).status();
+        }
     }
 
 }
@@ -7,11 +7,38 @@
 
 #pragma once
 
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
 #include "basic_socket.h"
 #include "APRS_Packet.h"
+#include "PacketClassifier.h"
 
 namespace aprs {
 
+    /**
+     * @brief Decoder state that outlives a single server connection.
+     */
+    struct DecoderContext {
+        /// Last known position of each station, used to place positionless weather reports.
+        std::unordered_map<std::string, std::pair<double, double>> mPositions{};
+
+        /// Stations which send positionless weather, only their non-weather positions need decoding.
+        std::unordered_set<std::string> mPositionless{};
+
+        /// True if the position of the station must be decoded to place its positionless weather.
+        [[nodiscard]] bool tracksPosition(std::string_view name) const {
+            // Callsigns fit the small string buffer, the key does not allocate.
+            return !mPositionless.empty() && mPositionless.count(std::string{name}) > 0;
+        }
+
+        /// Count of packets skipped by data type identifier.
+        std::map<char, unsigned long> mUnhandled{};
+
+        unsigned long mDecodeErrors{0};     ///< Count of packets which could not be decoded.
+        unsigned long mNoPosition{0};       ///< Count of weather reports from stations with no known position.
+    };
+
     class APRS_IS : public sockets::local_socket {
     public:
         std::string mPacket{};
@@ -26,12 +53,26 @@ namespace aprs {
 
         APRS_Position mQthPosition{};
 
+        std::shared_ptr<DecoderContext> mContext{std::make_shared<DecoderContext>()};
+
         bool mGoodServer = false;
 
-        APRS_IS(const std::string &callsign, const std::string &passCode, const std::string &filter);
+        static constexpr std::string_view DefaultServer = "cwop.aprs2.net";
+        static constexpr std::string_view DefaultPort = "14580";
+
+        APRS_IS(const std::string &callsign, const std::string &passCode, const std::string &filter,
+                const std::string &server = std::string{DefaultServer},
+                const std::string &port = std::string{DefaultPort});
 
         std::string getPacket();
 
+        /// Set a packet received elsewhere, for decoding.
+        void setPacket(std::string packet) {
+            mPacket = std::move(packet);
+            p0 = 0;
+            p1 = std::string::npos;
+        }
+
         char charAtIndex(int offset = 0) {
             return mPacket[p0 + offset];
         }
@@ -114,7 +155,40 @@ namespace aprs {
 
         std::optional<double> decodeCoordinate(CoordinateType coordinateType);
 
-        [[nodiscard]] std::unique_ptr<APRS_Packet> decode();
+        /// Decode a base 91 number of length characters as used in compressed positions.
+        std::optional<double> decodeBase91(std::size_t length);
+
+        /// Decode weather values identified by flag characters until a character which is not a flag.
+        void decodeWeatherData(APRS_WX_Report &wxReport);
+
+        /// Set distance and weight on a decoded weather report and mark it complete.
+        PacketStatus completeWeather(APRS_WX_Report &wxReport);
+
+        /// Keep only the position of a decoded report from a station which is not reporting weather.
+        static PacketStatus positionOnly(DecodedPacket &packet);
+
+        /// Decode an uncompressed or compressed position report, with weather if the symbol is '_'.
+        PacketStatus decodePosition(const std::string &name, bool timeStamp, DecodedPacket &packet);
+
+        /// Decode a positionless weather report placed at the station's last known position.
+        PacketStatus decodePositionlessWeather(const std::string &name, DecodedPacket &packet);
+
+        /// Decode a Mic-E position report, latitude is encoded in the destination address.
+        PacketStatus decodeMicE(const std::string &name, const std::string &destination, DecodedPacket &packet);
+
+        /// Decode the information field, p0 is at the data type identifier.
+        PacketStatus decodeInformation(const std::string &name, const std::string &destination,
+                                       DecodedPacket &packet);
+
+        /**
+         * @brief Decode the packet into a slot, normally one taken from a PacketPool.
+         * @param packet Set to the decoded packet, a weather report, a position or the status alone.
+         * @return The packet status.
+         */
+        PacketStatus decode(DecodedPacket &packet);
+
+        /// Decode a packet classified by PacketClassifier, starting at its information field.
+        PacketStatus decode(const PacketClassification &classification, DecodedPacket &packet);
     };
 }
 
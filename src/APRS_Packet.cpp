@@ -41,6 +41,15 @@ namespace aprs {
         return false;
     }
 
+    bool APRS_Position::setHannValue(double radius) {
+        if (mDistance.has_value() && radius > 0.) {
+            double hann = sin((M_PI * (radius - mDistance.value())) / (radius * 2.));
+            mHannValue = hann * hann;
+            return true;
+        }
+        return false;
+    }
+
     std::ostream &APRS_Position::printOn(std::ostream &strm) const {
         APRS_Packet::printOn(strm);
         if (mLat.has_value() && mLon.has_value())
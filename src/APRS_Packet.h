@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <array>
+#include <bitset>
 #include <iomanip>
 #include <iostream>
 #include <ios>
@@ -16,6 +18,7 @@
 #include <chrono>
 #include <optional>
 #include <stdexcept>
+#include <variant>
 
 namespace aprs {
     /// Convert radians to degrees.
@@ -67,8 +70,10 @@ namespace aprs {
     enum class PacketStatus {
         None,
         AprsPacket [[maybe_unused]],
-        PositionPacket [[maybe_unused]],
+        PositionPacket,
         WxPacket,
+        NoPosition,
+        Unsupported,
         DecodingError,
         ErrorLatitude,
         ErrorLongitude,
@@ -95,7 +100,7 @@ namespace aprs {
             mTimePoint = std::chrono::steady_clock::now();
         }
 
-        virtual std::ostream &printOn(std::ostream &strm) const;
+        std::ostream &printOn(std::ostream &strm) const;
     };
 
     class APRS_Position : public APRS_Packet {
@@ -104,7 +109,14 @@ namespace aprs {
 
         bool setBearingDistance(const APRS_Position &other);
 
-        std::ostream &printOn(std::ostream &strm) const override;
+        /**
+         * @brief Set the Hann window weight from the distance, one at the centre falling to zero at radius.
+         * @param radius The window radius in km.
+         * @return true if the distance was known and the weight set.
+         */
+        bool setHannValue(double radius);
+
+        std::ostream &printOn(std::ostream &strm) const;
     };
 
     enum class WxSym {
@@ -146,23 +158,24 @@ namespace aprs {
         Units units;
         double factor;
         int precision;
+        double spread;          ///< Smallest deviation scale used when screening for outliers.
     };
 
     static constexpr std::array<WeatherItem, 13>
             WeatherItemList{{
-                                    {WxSym::WindDirection, 'c', 3,"WDir", "Dir", "", Units::Degrees, 1., 0},
-                                    {WxSym::WindSpeed, 's', 3, "WSpeed", "Wind", "", Units::MPH, 1., 0},
-                                    {WxSym::WindGust, 'g', 3, "WGust", "Gust", "", Units::MPH, 1., 0},
-                                    {WxSym::Temperature, 't', 3,"Temp", "Temp", "", Units::Fahrenheit, 1., 0},
-                                    {WxSym::Humidity,'h', 2,"RelHum", "Humid", "", Units::Percent, 1., 0},
-                                    {WxSym::RainHour, 'r', 3,"RHour", "Rain", "/hour", Units::inch_100, 100, 2},
-                                    {WxSym::RainDay, 'p', 3,"RDay", "Rain", "/day", Units::inch_100, 100., 2},
-                                    {WxSym::RainMidnight, 'P', 3,"RainMid", "Rain", "since midniht", Units::inch_100, 100., 2},
-                                    {WxSym::Pressure, 'b', 5,"BarroP", "BP", "", Units::hPa, 10., 1},
-                                    {WxSym::Luminosity, 'L', 3,"Lumin", "Lumin", "", Units::wPSqm, 1., 0},
-                                    {WxSym::DewPoint, '\n', 0,"DewPt", "Dew Point", "", Units::Celsius, 1., 0},
-                                    {WxSym::Humidex, '\n', 0,"Humidex", "Humidex", "", Units::Celsius, 1., 0},
-                                    {WxSym::Luminosity, 'l', 3,"Lumin", "Lumin", "", Units::wPSqm, 1., 0}
+                                    {WxSym::WindDirection, 'c', 3,"WDir", "Dir", "", Units::Degrees, 1., 0, 360.},
+                                    {WxSym::WindSpeed, 's', 3, "WSpeed", "Wind", "", Units::MPH, 1., 0, 5.},
+                                    {WxSym::WindGust, 'g', 3, "WGust", "Gust", "", Units::MPH, 1., 0, 8.},
+                                    {WxSym::Temperature, 't', 3,"Temp", "Temp", "", Units::Fahrenheit, 1., 0, 4.},
+                                    {WxSym::Humidity,'h', 2,"RelHum", "Humid", "", Units::Percent, 1., 0, 8.},
+                                    {WxSym::RainHour, 'r', 3,"RHour", "Rain", "/hour", Units::inch_100, 100, 2, .2},
+                                    {WxSym::RainDay, 'p', 3,"RDay", "Rain", "/day", Units::inch_100, 100., 2, .5},
+                                    {WxSym::RainMidnight, 'P', 3,"RainMid", "Rain", "since midniht", Units::inch_100, 100., 2, .5},
+                                    {WxSym::Pressure, 'b', 5,"BarroP", "BP", "", Units::hPa, 10., 1, 2.},
+                                    {WxSym::Luminosity, 'L', 3,"Lumin", "Lumin", "", Units::wPSqm, 1., 0, 100.},
+                                    {WxSym::DewPoint, '\n', 0,"DewPt", "Dew Point", "", Units::Celsius, 1., 0, 0.},
+                                    {WxSym::Humidex, '\n', 0,"Humidex", "Humidex", "", Units::Celsius, 1., 0, 0.},
+                                    {WxSym::Luminosity, 'l', 3,"Lumin", "Lumin", "", Units::wPSqm, 1., 0, 100.}
                             }};
 
     static constexpr std::size_t WeatherItemCount = WeatherItemList.size();
@@ -176,14 +189,24 @@ namespace aprs {
 
     class APRS_WX_Report : public APRS_Position {
     public:
-        virtual ~APRS_WX_Report() = default;
-
         std::string mDateTime{};
         std::array<std::optional<double>,WeatherItemCount> mWeatherValue;
+        std::bitset<WeatherItemCount> mRejected{};      ///< Values excluded from the aggregate as outliers.
 
         void decodeWeatherValue(APRS_IS &aprs_is, WxSym wxSym, char valueFlag = '\0', double factor = 1.);
 
-        std::ostream &printOn(std::ostream &strm) const override;
+        std::ostream &printOn(std::ostream &strm) const;
     };
+
+    /**
+     * @brief A decoded packet held by value, the status alone, the position of a station which is not
+     * reporting weather, or a weather report. The kind is the variant index, no virtual dispatch is needed.
+     */
+    using DecodedPacket = std::variant<APRS_Packet, APRS_Position, APRS_WX_Report>;
+
+    /// The part of a decoded packet common to every kind.
+    inline const APRS_Packet &packetBase(const DecodedPacket &packet) {
+        return std::visit([](const APRS_Packet &base) -> const APRS_Packet & { return base; }, packet);
+    }
 }
 
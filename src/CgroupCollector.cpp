@@ -0,0 +1,88 @@
+/**
+ * @file CgroupCollector.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-14
+ */
+
+#include "CgroupCollector.h"
+
+namespace {
+    /// Find the value of a "key value" line in a flat keyed cgroup file.
+    std::optional<unsigned long long> keyedValue(std::string_view content, std::string_view key) {
+        while (!content.empty()) {
+            auto line = Collector::nextLine(content);
+            if (line.size() > key.size() && line.substr(0, key.size()) == key && line[key.size()] == ' ') {
+                line.remove_prefix(key.size());
+                return Collector::nextNumber(line);
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+CgroupCollector::Unit::Unit(const std::string &path) : mCpuStat{path + "/cpu.stat", 1024},
+                                                       mMemoryCurrent{path + "/memory.current", 64},
+                                                       mMemoryStat{path + "/memory.stat", 8192},
+                                                       mIoStat{path + "/io.stat", 4096} {}
+
+CgroupCollector::CgroupCollector(std::string_view host, const std::vector<std::string> &units) {
+    mUnits.reserve(units.size());
+    for (auto &name : units) {
+        auto &unit = mUnits.emplace_back("/sys/fs/cgroup/system.slice/" + name);
+        unit.mCpu.mSeries = "service,host=" + std::string{host} + ",unit=" + escapeTag(name);
+        unit.mIo.mSeries = unit.mCpu.mSeries;
+    }
+}
+
+bool CgroupCollector::sample(MetricSink &sink) {
+    auto interval = mClock.lap();
+    bool ok = true;
+
+    for (auto &unit : mUnits) {
+        auto &series = unit.mCpu.mSeries;
+
+        // Microseconds of cpu time per second of interval, as a percentage of one core.
+        if (auto cpuStat = unit.mCpuStat.read(); cpuStat.has_value()) {
+            for (std::size_t idx = 0; idx < CpuItemCount; ++idx)
+                unit.mCpu.mCounter[idx] = keyedValue(cpuStat.value(), mCpuKeys[idx]).value_or(0);
+            unit.mCpu.sendRates(sink, mCpuFields, interval, 1.e-4);
+        } else {
+            // The service is not running, rates restart from its next sample.
+            unit.mCpu.mValid = false;
+            ok = false;
+        }
+
+        if (auto current = unit.mMemoryCurrent.read(); current.has_value()) {
+            auto view = current.value();
+            if (auto value = nextNumber(view); value.has_value())
+                unit.mMemory[Current].update(sink, series, mMemoryFields[Current], static_cast<double>(value.value()));
+        }
+
+        if (auto memoryStat = unit.mMemoryStat.read(); memoryStat.has_value()) {
+            if (auto value = keyedValue(memoryStat.value(), "anon"); value.has_value())
+                unit.mMemory[Anon].update(sink, series, mMemoryFields[Anon], static_cast<double>(value.value()));
+            if (auto value = keyedValue(memoryStat.value(), "file"); value.has_value())
+                unit.mMemory[File].update(sink, series, mMemoryFields[File], static_cast<double>(value.value()));
+        }
+
+        // One line per device, "MAJ:MIN rbytes=N wbytes=N rios=N wios=N dbytes=N dios=N", summed.
+        if (auto ioStat = unit.mIoStat.read(); ioStat.has_value()) {
+            unit.mIo.mCounter.fill(0);
+            auto view = ioStat.value();
+            while (!view.empty()) {
+                auto line = nextLine(view);
+                for (std::size_t idx = 0; idx < IoItemCount; ++idx) {
+                    if (auto p = line.find(mIoKeys[idx]); p != std::string_view::npos) {
+                        auto field = line.substr(p + mIoKeys[idx].size());
+                        unit.mIo.mCounter[idx] += nextNumber(field).value_or(0);
+                    }
+                }
+            }
+            unit.mIo.sendRates(sink, mIoFields, interval);
+        } else {
+            unit.mIo.mValid = false;
+        }
+    }
+    return ok;
+}
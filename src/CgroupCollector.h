@@ -0,0 +1,70 @@
+/**
+ * @file CgroupCollector.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-14
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <vector>
+#include "Collector.h"
+#include "ProcFile.h"
+#include "SystemCollectors.h"
+
+/**
+ * @class CgroupCollector
+ * @brief Per service CPU, memory and I/O from the cgroup v2 hierarchy systemd creates for each unit.
+ * @details For each configured unit the cpu.stat, memory.current, memory.stat and io.stat files under
+ * /sys/fs/cgroup/system.slice/UNIT are held open and re-read each sample. When a service restarts systemd
+ * creates a new cgroup, the read on the old descriptor fails and the file is reopened. Counters which go
+ * backwards after a restart are skipped for one interval. Metrics are sent on "service,host=H,unit=UNIT".
+ */
+class CgroupCollector : public Collector {
+protected:
+    enum CpuItem {
+        Usage, User, System, CpuItemCount
+    };
+
+    enum IoItem {
+        ReadBytes, WriteBytes, ReadIos, WriteIos, IoItemCount
+    };
+
+    enum MemoryItem {
+        Current, Anon, File, MemoryItemCount
+    };
+
+    static constexpr std::array<std::string_view, CpuItemCount> mCpuFields{"cpu", "cpuUser", "cpuSystem"};
+    static constexpr std::array<std::string_view, CpuItemCount> mCpuKeys{"usage_usec", "user_usec", "system_usec"};
+    static constexpr std::array<std::string_view, IoItemCount> mIoFields{
+            "readBytes", "writeBytes", "readIops", "writeIops"};
+    static constexpr std::array<std::string_view, IoItemCount> mIoKeys{"rbytes=", "wbytes=", "rios=", "wios="};
+    static constexpr std::array<std::string_view, MemoryItemCount> mMemoryFields{"memory", "memoryAnon", "memoryFile"};
+
+    struct Unit {
+        ProcFile mCpuStat;
+        ProcFile mMemoryCurrent;
+        ProcFile mMemoryStat;
+        ProcFile mIoStat;
+        CounterSet<CpuItemCount> mCpu{};
+        CounterSet<IoItemCount> mIo{};
+        std::array<Gauge, MemoryItemCount> mMemory{};
+
+        explicit Unit(const std::string &path);
+    };
+
+    std::vector<Unit> mUnits{};
+    RateClock mClock{};
+
+public:
+    /**
+     * @brief Constructor
+     * @param host The host name used to tag measurements.
+     * @param units The systemd service units, e.g. APRS_WX.service.
+     */
+    CgroupCollector(std::string_view host, const std::vector<std::string> &units);
+
+    bool sample(MetricSink &sink) override;
+};
@@ -0,0 +1,108 @@
+/**
+ * @file Collector.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#include <iostream>
+#include <filesystem>
+#include "Collector.h"
+#include "CpuStats.h"
+#include "ThermalZone.h"
+#include "SystemCollectors.h"
+#include "ProcessCollector.h"
+#include "CgroupCollector.h"
+#include "PressureCollector.h"
+#include "SensorCollectors.h"
+
+const std::vector<CollectorRegistry::Entry> &CollectorRegistry::available() {
+    static const std::vector<Entry> entries{{
+            {"cpu", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                return std::make_unique<CpuStats>(config.host);
+            }},
+            {"temp", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                if (!config.cpuZone.has_value())
+                    return nullptr;
+                auto zone = std::make_unique<ThermalZone>(config.host, config.cpuZone.value());
+                if (!std::filesystem::exists(zone->path()))
+                    return nullptr;
+                return zone;
+            }},
+            {"mem", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                return std::make_unique<MemInfoCollector>(config.host);
+            }},
+            {"disk", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                return std::make_unique<DiskStatsCollector>(config.host);
+            }},
+            {"net", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                return std::make_unique<NetDevCollector>(config.host);
+            }},
+            {"fs", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                return std::make_unique<FsUsageCollector>(config.host, config.filesystems);
+            }},
+            {"proc", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                auto collector = std::make_unique<ProcessCollector>(config.host, config.topProcesses);
+                if (!collector->valid())
+                    return nullptr;
+                return collector;
+            }},
+            {"cgroup", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                // Requires the unified (v2) hierarchy.
+                if (config.units.empty() || !std::filesystem::exists("/sys/fs/cgroup/cgroup.controllers"))
+                    return nullptr;
+                return std::make_unique<CgroupCollector>(config.host, config.units);
+            }},
+            {"pressure", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                if (!std::filesystem::exists("/proc/pressure"))
+                    return nullptr;
+                return std::make_unique<PressureCollector>(config.host, config.pressureTrigger);
+            }},
+            {"thermal", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                auto collector = std::make_unique<ThermalCollector>(config.host);
+                if (!collector->available())
+                    return nullptr;
+                return collector;
+            }},
+            {"hwmon", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                auto collector = std::make_unique<HwmonCollector>(config.host);
+                if (!collector->available())
+                    return nullptr;
+                return collector;
+            }},
+            {"cpufreq", [](const CollectorConfig &config) -> std::unique_ptr<Collector> {
+                auto collector = std::make_unique<CpuFreqCollector>(config.host);
+                if (!collector->available())
+                    return nullptr;
+                return collector;
+            }},
+    }};
+    return entries;
+}
+
+bool CollectorRegistry::add(std::string_view name, const CollectorConfig &config) {
+    for (auto &entry : available()) {
+        if (entry.name == name) {
+            if (auto collector = entry.factory(config); collector) {
+                mCollectors.push_back(std::move(collector));
+                return true;
+            }
+            std::cerr << "Collector " << name << " is not available on this system.\n";
+            return false;
+        }
+    }
+    std::cerr << "Unknown collector " << name << '\n';
+    return false;
+}
+
+bool CollectorRegistry::addList(std::string_view names, const CollectorConfig &config) {
+    bool ok = true;
+    while (!names.empty()) {
+        auto comma = names.find(',');
+        auto name = names.substr(0, comma);
+        names.remove_prefix(comma == std::string_view::npos ? names.size() : comma + 1);
+        if (!name.empty())
+            ok = add(name, config) && ok;
+    }
+    return ok;
+}
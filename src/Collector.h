@@ -0,0 +1,209 @@
+/**
+ * @file Collector.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <optional>
+#include <limits>
+#include <charconv>
+
+/**
+ * @class MetricSink
+ * @brief Receives the metrics produced by collectors.
+ */
+class MetricSink {
+public:
+    virtual ~MetricSink() = default;
+
+    /**
+     * @brief Receive one metric value.
+     * @param series The measurement and tag set, e.g. "sys,host=pi". Collectors build series keys once,
+     * the same key is passed on every sample.
+     * @param field The field name.
+     * @param value The value.
+     */
+    virtual void metric(std::string_view series, std::string_view field, double value) = 0;
+
+    /**
+     * @brief Receive a value which identifies rather than measures, such as a pid.
+     * @details Sinks which summarize samples pass on the latest value instead of a summary.
+     */
+    virtual void label(std::string_view series, std::string_view field, double value) {
+        metric(series, field, value);
+    }
+
+    /**
+     * @brief Receive a value which was not sent because it has not changed since it was last sent.
+     * @details Sinks which write values as they come ignore it, sinks which summarize samples count it
+     * as a sample. A metric which gets neither a value nor this call in a sample has no value.
+     */
+    virtual void unchanged(std::string_view, std::string_view, double) {}
+};
+
+/**
+ * @class TeeSink
+ * @brief Send every metric to two sinks.
+ */
+class TeeSink : public MetricSink {
+protected:
+    MetricSink &mFirst;
+    MetricSink &mSecond;
+
+public:
+    TeeSink(MetricSink &first, MetricSink &second) : mFirst{first}, mSecond{second} {}
+
+    void metric(std::string_view series, std::string_view field, double value) override {
+        mFirst.metric(series, field, value);
+        mSecond.metric(series, field, value);
+    }
+
+    void label(std::string_view series, std::string_view field, double value) override {
+        mFirst.label(series, field, value);
+        mSecond.label(series, field, value);
+    }
+
+    void unchanged(std::string_view series, std::string_view field, double value) override {
+        mFirst.unchanged(series, field, value);
+        mSecond.unchanged(series, field, value);
+    }
+};
+
+/**
+ * @class Collector
+ * @brief A source of system metrics sampled by SYS_MONITOR.
+ * @details Collectors open their sources when constructed and keep any state needed to compute rates
+ * between samples. Once running a sample should not allocate.
+ */
+class Collector {
+public:
+    virtual ~Collector() = default;
+
+    /**
+     * @brief Take a sample and send the resulting metrics to the sink.
+     * @return false if the source could not be read.
+     */
+    virtual bool sample(MetricSink &sink) = 0;
+
+    /**
+     * @brief Add any descriptors which signal an event with POLLPRI, such as pressure triggers.
+     */
+    virtual void triggerFds(std::vector<int> &) const {}
+
+    /**
+     * @brief Parse the next unsigned decimal number in a view, advancing the view past it.
+     * @return the number or std::nullopt if there is none.
+     */
+    static std::optional<unsigned long long> nextNumber(std::string_view &view) {
+        auto p = view.find_first_of("0123456789");
+        if (p == std::string_view::npos) {
+            view = std::string_view{};
+            return std::nullopt;
+        }
+        unsigned long long value{};
+        auto [ptr, ec] = std::from_chars(view.data() + p, view.data() + view.size(), value);
+        view.remove_prefix(static_cast<std::size_t>(ptr - view.data()));
+        if (ec != std::errc())
+            return std::nullopt;
+        return value;
+    }
+
+    /**
+     * @brief Split the next line from a view, advancing the view past it.
+     */
+    static std::string_view nextLine(std::string_view &view) {
+        auto eol = view.find('\n');
+        auto line = view.substr(0, eol);
+        view.remove_prefix(eol == std::string_view::npos ? view.size() : eol + 1);
+        return line;
+    }
+};
+
+/**
+ * @class Gauge
+ * @brief Remember the last value sent for a field so unchanged values can be skipped.
+ * @details A skipped value is passed to MetricSink::unchanged() so a sink can tell it from a missing one.
+ */
+class Gauge {
+protected:
+    double mLast{std::numeric_limits<double>::quiet_NaN()};
+
+public:
+    /// Send the value to the sink if it differs from the last value sent, otherwise report it unchanged.
+    void update(MetricSink &sink, std::string_view series, std::string_view field, double value) {
+        if (value != mLast) {
+            sink.metric(series, field, value);
+            mLast = value;
+        } else {
+            sink.unchanged(series, field, value);
+        }
+    }
+};
+
+/**
+ * @brief Settings used by the registry to construct collectors.
+ */
+struct CollectorConfig {
+    std::string host{};                     ///< Host name used to tag all series.
+    std::optional<long> cpuZone{};          ///< The thermal zone for cpuTemp.
+    std::vector<std::string> filesystems{}; ///< Mount points reported by the fs collector.
+    std::size_t topProcesses{5};            ///< Processes reported by CPU and by memory.
+    std::vector<std::string> units{};       ///< Systemd services reported by the cgroup collector.
+    std::optional<long> pressureTrigger{};  ///< Stall microseconds per window which trigger a burst.
+};
+
+/**
+ * @class CollectorRegistry
+ * @brief Construct collectors by name and sample them together.
+ */
+class CollectorRegistry {
+public:
+    using Factory = std::unique_ptr<Collector> (*)(const CollectorConfig &);
+
+    struct Entry {
+        std::string_view name;
+        Factory factory;
+    };
+
+    /// The collectors available to the configuration file.
+    static const std::vector<Entry> &available();
+
+protected:
+    std::vector<std::unique_ptr<Collector>> mCollectors{};
+
+public:
+    /**
+     * @brief Construct a collector by name and add it to the registry.
+     * @return false if the name is not known or the collector could not be constructed.
+     */
+    bool add(std::string_view name, const CollectorConfig &config);
+
+    /**
+     * @brief Add every collector named in a comma separated list.
+     * @return false if any could not be added.
+     */
+    bool addList(std::string_view names, const CollectorConfig &config);
+
+    [[nodiscard]] bool empty() const { return mCollectors.empty(); }
+
+    /// The trigger descriptors of every collector.
+    [[nodiscard]] std::vector<int> triggerFds() const {
+        std::vector<int> fds{};
+        for (auto &collector : mCollectors)
+            collector->triggerFds(fds);
+        return fds;
+    }
+
+    /// Sample every collector into the sink.
+    void sample(MetricSink &sink) {
+        for (auto &collector : mCollectors)
+            collector->sample(sink);
+    }
+};
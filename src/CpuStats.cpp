@@ -0,0 +1,130 @@
+/**
+ * @file CpuStats.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#include <iostream>
+#include <charconv>
+#include "CpuStats.h"
+
+bool CpuStats::getData() {
+    auto content = mProcStat.read();
+    if (!content.has_value())
+        return false;
+
+    std::string_view buffer{content.value()};
+    std::size_t cpuIdx = 0;
+    while (buffer.substr(0, 3) == "cpu") {
+        // Only complete lines, the buffer may end part way through the file.
+        auto eol = buffer.find('\n');
+        if (eol == std::string_view::npos)
+            break;
+        auto line_view = buffer.substr(0, eol);
+        buffer = buffer.substr(eol + 1);
+
+        auto p = line_view.find(' ');
+        auto name = line_view.substr(0, p);
+        if (cpuIdx == mCpus.size())
+            mCpus.emplace_back();
+        auto &cpu = mCpus[cpuIdx++];
+        if (cpu.mName != name) {
+            // A core has come or gone, the previous sample for this slot is not comparable.
+            cpu.mName = name;
+            cpu.mSeries = "cpu,host=" + mHost + ",cpu=" + cpu.mName;
+            cpu.mValid = false;
+        }
+
+        p = line_view.find_first_of("0123456789", p);
+        auto idx = static_cast<std::size_t>(User);
+        while (p != std::string_view::npos && idx < static_cast<std::size_t>(ItemCount)) {
+            ProcStatDataType value{};
+            auto [ptr, ec] {std::from_chars(line_view.data() + p, line_view.data() + line_view.size(), value)};
+            if (ec == std::errc()) {
+                cpu.mData[idx] = value;
+                p = line_view.find_first_of("0123456789", static_cast<std::size_t>(ptr - line_view.data()));
+                ++idx;
+            } else if (ec == std::errc::invalid_argument) {
+                std::cerr << "CPU Stat invalid argument\n";
+                return false;
+            } else if (ec == std::errc::result_out_of_range) {
+                std::cerr << "CPU Stat result out of range\n";
+                return false;
+            }
+        }
+    }
+    mCpus.resize(cpuIdx);
+
+    return cpuIdx > 0;
+}
+
+std::tuple<CpuStats::ProcStatDataType, CpuStats::ProcStatDataType> CpuStats::getUsage(std::size_t cpu) const {
+    ProcStatDataType used{}, idle{};
+    if (cpu >= mCpus.size() || !mCpus[cpu].mValid)
+        return std::make_tuple(used, idle);
+
+    for (auto idx = static_cast<std::size_t>(User); idx < static_cast<std::size_t>(ItemCount); ++idx) {
+        switch (static_cast<Item>(idx)) {
+            case Idle:
+            case IOWait:
+                idle += delta(mCpus[cpu], static_cast<Item>(idx));
+                break;
+            case Guest:
+            case GuestNice:
+                // Guest time is already counted in User and Nice.
+            case ItemCount:
+                break;
+            default:
+                used += delta(mCpus[cpu], static_cast<Item>(idx));
+        }
+    }
+
+    return std::make_tuple(used, idle);
+}
+
+bool CpuStats::sample(MetricSink &sink) {
+    if (!getData())
+        return false;
+
+    auto [used, idle] = getUsage();
+    double percentUsage = 0.;
+    if ((used + idle) != 0)
+        percentUsage = 100.0 * static_cast<double>(used) / static_cast<double>(used + idle);
+    sink.metric(mSysSeries, "cpuUse", percentUsage);
+
+    // Per state usage of the aggregate, "cpu", and of each core.
+    for (std::size_t cpu = 0; cpu < mCpus.size(); ++cpu) {
+        if (auto usage = getPercentages(cpu); usage.has_value()) {
+            auto &series = mCpus[cpu].mSeries;
+            sink.metric(series, "use", usage->use);
+            sink.metric(series, "user", usage->user);
+            sink.metric(series, "system", usage->system);
+            sink.metric(series, "iowait", usage->iowait);
+            sink.metric(series, "irq", usage->irq);
+            sink.metric(series, "steal", usage->steal);
+        }
+    }
+
+    setPastData();
+    return true;
+}
+
+std::optional<CpuStats::Usage> CpuStats::getPercentages(std::size_t cpu) const {
+    auto [used, idle] = getUsage(cpu);
+    if (used + idle == 0)
+        return std::nullopt;
+
+    auto &stats = mCpus[cpu];
+    auto total = static_cast<double>(used + idle);
+    auto percent = [total](ProcStatDataType value) {
+        return 100.0 * static_cast<double>(value) / total;
+    };
+
+    return Usage{percent(used),
+                 percent(delta(stats, User) + delta(stats, Nice)),
+                 percent(delta(stats, System)),
+                 percent(delta(stats, IOWait)),
+                 percent(delta(stats, IRQ) + delta(stats, SoftIRQ)),
+                 percent(delta(stats, Steal))};
+}
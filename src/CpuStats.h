@@ -0,0 +1,119 @@
+/**
+ * @file CpuStats.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tuple>
+#include <optional>
+#include "ProcFile.h"
+#include "Collector.h"
+
+/**
+ * @class CpuStats
+ * @brief A Class to fetch, process and store CPU operating statistics.
+ * @details The aggregate "cpu" line and every "cpuN" line of /proc/stat are parsed in one pass over a
+ * buffer which is reused between samples. Index 0 is the aggregate, 1 to N the individual cores.
+ */
+class CpuStats : public Collector {
+public:
+    using ProcStatDataType = unsigned long long;    ///< Type to store stats data in
+
+    enum Item {
+        User,
+        Nice,
+        System,
+        Idle,
+        IOWait,
+        IRQ,
+        SoftIRQ,
+        Steal,
+        Guest,
+        GuestNice,
+        ItemCount   // Must be last.
+    };
+
+    using Counters = std::array<ProcStatDataType, static_cast<std::size_t>(ItemCount)>;
+
+    /**
+     * @brief Time spent in each state over the last interval, in percent.
+     */
+    struct Usage {
+        double use;         ///< Time not idle or waiting for I/O.
+        double user;        ///< User and nice time.
+        double system;
+        double iowait;
+        double irq;         ///< Hard and soft interrupt time.
+        double steal;
+    };
+
+protected:
+    struct Cpu {
+        std::string mName{};
+        std::string mSeries{};  ///< Line protocol series key for this cpu.
+        Counters mData{};
+        Counters mPastData{};
+        bool mValid{false};     ///< True when mPastData holds a previous sample.
+    };
+
+    static constexpr std::string_view mProcStatFile {"/proc/stat"};
+    static constexpr std::size_t mProcStatSize = 16384;     ///< Enough for the cpu lines of 128 cores.
+    ProcFile mProcStat;
+    std::string mHost{};
+    std::string mSysSeries{};   ///< Series which receives the overall cpuUse field.
+    std::vector<Cpu> mCpus{};
+
+    [[nodiscard]] static ProcStatDataType delta(const Cpu &cpu, Item item) {
+        return cpu.mData[static_cast<std::size_t>(item)] - cpu.mPastData[static_cast<std::size_t>(item)];
+    }
+
+public:
+    /**
+     * @brief Constructor
+     * @param host The host name used to tag measurements.
+     */
+    explicit CpuStats(std::string_view host = {}) : mProcStat{std::string{mProcStatFile}, mProcStatSize},
+                                                    mHost{host}, mSysSeries{"sys,host=" + mHost} {}
+
+    /// Read and parse all cpu lines of /proc/stat.
+    bool getData();
+
+    void setPastData() {
+        for (auto &cpu : mCpus) {
+            cpu.mPastData = cpu.mData;
+            cpu.mValid = true;
+        }
+    }
+
+    /// The number of cpu lines, the aggregate plus one per core.
+    [[nodiscard]] std::size_t size() const { return mCpus.size(); }
+
+    /// The name of a cpu line, "cpu" for the aggregate, "cpuN" for cores.
+    [[nodiscard]] const std::string &name(std::size_t cpu) const { return mCpus[cpu].mName; }
+
+    /**
+     * @brief Get the used and idle jiffies since the last call to setPastData().
+     * @param cpu The cpu line, 0 for the aggregate.
+     */
+    [[nodiscard]] std::tuple<ProcStatDataType,ProcStatDataType> getUsage(std::size_t cpu = 0) const;
+
+    /**
+     * @brief Get the per state usage since the last call to setPastData().
+     * @param cpu The cpu line, 0 for the aggregate.
+     * @return The usage or std::nullopt if there is no previous sample or no time has passed.
+     */
+    [[nodiscard]] std::optional<Usage> getPercentages(std::size_t cpu = 0) const;
+
+    /**
+     * @brief Sample the counters and send usage since the previous sample.
+     * @return false if /proc/stat could not be read.
+     */
+    bool sample(MetricSink &sink) override;
+};
@@ -0,0 +1,85 @@
+/**
+ * @file DhtSensor.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-18
+ */
+
+#include <array>
+#include <thread>
+#include "DhtSensor.h"
+
+std::optional<DhtReading> decodeDht(const std::vector<GpioEdge> &edges, DhtType type) {
+    static constexpr std::size_t FrameBits = 40;
+    static constexpr std::uint64_t OneThreshold = 48;       // Microseconds, between 27 and 70.
+    static constexpr std::uint64_t MaxBitHigh = 100;
+
+    // Collect the lengths of the last 40 high pulses, working back from the end.
+    std::array<std::uint64_t, FrameBits> high{};
+    std::size_t count{0};
+    for (std::size_t i = edges.size(); i > 1 && count < FrameBits; --i) {
+        auto &fall = edges[i - 1];
+        auto &rise = edges[i - 2];
+        if (!fall.level && rise.level && fall.micros >= rise.micros)
+            high[FrameBits - ++count] = fall.micros - rise.micros;
+    }
+    if (count < FrameBits)
+        return std::nullopt;
+
+    std::array<unsigned, 5> bytes{};
+    for (std::size_t bit = 0; bit < FrameBits; ++bit) {
+        if (high[bit] > MaxBitHigh)
+            return std::nullopt;
+        bytes[bit / 8] = (bytes[bit / 8] << 1) | (high[bit] > OneThreshold ? 1u : 0u);
+    }
+    if (bytes[4] != ((bytes[0] + bytes[1] + bytes[2] + bytes[3]) & 0xFFu))
+        return std::nullopt;
+
+    double humidity, temperature;
+    if (type == DhtType::DHT11) {
+        humidity = bytes[0] + bytes[1] / 10.;
+        temperature = bytes[2] + (bytes[3] & 0x7Fu) / 10.;
+        if (bytes[3] & 0x80u)
+            temperature = -temperature;
+    } else {
+        humidity = ((bytes[0] << 8) | bytes[1]) / 10.;
+        temperature = (((bytes[2] & 0x7Fu) << 8) | bytes[3]) / 10.;
+        if (bytes[2] & 0x80u)
+            temperature = -temperature;
+    }
+
+    // An all zero frame passes the checksum, and a marginal line can give plausible garbage.
+    if (humidity <= 0. || humidity > 100. || temperature < -40. || temperature > 80.)
+        return std::nullopt;
+
+    return DhtReading{temperature, humidity, std::chrono::system_clock::now()};
+}
+
+std::optional<DhtReading> DhtSensor::read(std::chrono::seconds maxAge) {
+    // DHT11 needs at least 18ms of start pulse, DHT22 at least 1ms. The frame takes about 5ms.
+    static constexpr std::chrono::microseconds Dht11Start{18000};
+    static constexpr std::chrono::microseconds Dht22Start{1100};
+    static constexpr std::chrono::microseconds CaptureWindow{10000};
+
+    if (mCache && Clock::now() - mCacheTime < mMinInterval)
+        return mCache;
+
+    for (unsigned attempt = 0; attempt <= mRetries; ++attempt) {
+        if (mLastAttempt)
+            std::this_thread::sleep_until(mLastAttempt.value() + mMinInterval);
+        mLastAttempt = Clock::now();
+
+        if (mGpio->request(mType == DhtType::DHT11 ? Dht11Start : Dht22Start, CaptureWindow, mEdges)) {
+            if (auto reading = decodeDht(mEdges, mType); reading) {
+                mCache = reading;
+                mCacheTime = mLastAttempt.value();
+                return reading;
+            }
+        }
+        ++mFailures;
+    }
+
+    if (mCache && Clock::now() - mCacheTime <= maxAge)
+        return mCache;
+    return std::nullopt;
+}
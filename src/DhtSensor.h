@@ -0,0 +1,87 @@
+/**
+ * @file DhtSensor.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-18
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <vector>
+#include "GpioBackend.h"
+
+/**
+ * @brief The DHT sensor variants, which differ in start pulse and data format.
+ */
+enum class DhtType {
+    DHT11,
+    DHT22,      ///< Also sold as AM2302.
+};
+
+/**
+ * @brief A temperature and humidity reading.
+ */
+struct DhtReading {
+    double temperature;     ///< Degrees Celsius.
+    double humidity;        ///< Percent relative humidity.
+    std::chrono::system_clock::time_point time;
+};
+
+/**
+ * @brief Decode a DHT frame from the edges of the sensor response.
+ * @details Bits are encoded in the length of the high pulses, about 27us for 0 and 70us for 1, so only
+ * high pulses are measured, which makes decoding independent of the start pulse and of whether the
+ * response preamble was captured. The last 40 high pulses are the frame, which must pass its checksum
+ * and give values within the sensor range.
+ * @return The reading, with the current time, or std::nullopt.
+ */
+std::optional<DhtReading> decodeDht(const std::vector<GpioEdge> &edges, DhtType type);
+
+/**
+ * @class DhtSensor
+ * @brief Read a DHT sensor through a GPIO backend with retries and caching.
+ * @details The sensor must rest for at least 2 seconds between reads. A read within that time of the last
+ * good reading returns it from the cache. Otherwise the sensor is read, and retried up to the retry
+ * count, with each attempt waiting out the minimum interval since the previous one.
+ */
+class DhtSensor {
+protected:
+    using Clock = std::chrono::steady_clock;
+
+    std::unique_ptr<GpioBackend> mGpio;
+    DhtType mType;
+    std::chrono::milliseconds mMinInterval;
+    unsigned mRetries;
+    std::vector<GpioEdge> mEdges{};
+    std::optional<DhtReading> mCache{};
+    Clock::time_point mCacheTime{};
+    std::optional<Clock::time_point> mLastAttempt{};
+    unsigned long mFailures{0};
+
+public:
+    static constexpr std::chrono::milliseconds MinInterval{2000};
+
+    /**
+     * @brief Constructor
+     * @param gpio The backend for the sensor data line.
+     * @param type The sensor type.
+     * @param retries Attempts after the first before a read fails.
+     * @param minInterval The rest time between reads, only shortened for simulated sensors.
+     */
+    DhtSensor(std::unique_ptr<GpioBackend> gpio, DhtType type, unsigned retries = 2,
+              std::chrono::milliseconds minInterval = MinInterval)
+            : mGpio{std::move(gpio)}, mType{type}, mMinInterval{minInterval}, mRetries{retries} {}
+
+    /**
+     * @brief Get a reading.
+     * @param maxAge If the sensor can not be read return the last good reading if it is no older than this.
+     * @return The reading or std::nullopt.
+     */
+    std::optional<DhtReading> read(std::chrono::seconds maxAge = std::chrono::seconds{0});
+
+    /// Attempts which did not decode since construction.
+    [[nodiscard]] unsigned long failures() const { return mFailures; }
+};
@@ -0,0 +1,249 @@
+/**
+ * @file FeedMerger.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-23
+ */
+
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string_view>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "FeedMerger.h"
+#include "APRS_IS.h"
+
+namespace aprs {
+
+    namespace {
+        /// Identify a packet by its source, destination and information field, leaving out the path.
+        std::size_t packetHash(std::string_view line) {
+            auto gt = line.find('>');
+            auto colon = line.find(':', gt == std::string_view::npos ? 0 : gt);
+            if (gt == std::string_view::npos || colon == std::string_view::npos)
+                return std::hash<std::string_view>{}(line);
+            auto comma = line.find(',', gt);
+            auto address = line.substr(0, std::min(comma, colon));
+            auto info = line.substr(colon);
+            while (!info.empty() && (info.back() == '\n' || info.back() == '\r'))
+                info.remove_suffix(1);
+            return std::hash<std::string_view>{}(address) * 31 + std::hash<std::string_view>{}(info);
+        }
+    }
+
+    FeedMerger::FeedMerger(std::string server, std::string port, std::size_t connections, std::string callsign,
+                           std::string passCode, std::string filter, unsigned long cycleRate)
+            : mServer{std::move(server)}, mPort{std::move(port)}, mCallSign{std::move(callsign)}, mPassCode{std::move(passCode)}, mFilter{std::move(filter)},
+              mCycleRate{cycleRate}, mConnections(std::clamp<std::size_t>(connections, 1, MaxConnections)) {
+        for (std::size_t index = 0; index < mConnections.size(); ++index)
+            mConnections[index].thread = std::thread{&FeedMerger::run, this, index};
+    }
+
+    FeedMerger::~FeedMerger() {
+        stop();
+    }
+
+    void FeedMerger::stop() {
+        {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mStop = true;
+            // Wake readers waiting on the server.
+            for (auto &connection : mConnections)
+                if (connection.fd >= 0)
+                    ::shutdown(connection.fd, SHUT_RDWR);
+        }
+        mCondition.notify_all();
+        for (auto &connection : mConnections)
+            if (connection.thread.joinable())
+                connection.thread.join();
+    }
+
+    void FeedMerger::setFilter(const std::string &filter) {
+        std::lock_guard<std::mutex> lock{mMutex};
+        if (filter != mFilter) {
+            mFilter = filter;
+            ++mFilterGeneration;
+        }
+    }
+
+    std::string FeedMerger::chooseServer(std::size_t index) {
+        std::vector<std::string> addresses{};
+        addrinfo hints{};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *result = nullptr;
+        if (getaddrinfo(mServer.c_str(), mPort.c_str(), &hints, &result) == 0) {
+            for (auto info = result; info != nullptr; info = info->ai_next) {
+                char host[NI_MAXHOST];
+                if (getnameinfo(info->ai_addr, info->ai_addrlen, host, sizeof(host), nullptr, 0, NI_NUMERICHOST) == 0 &&
+                    std::find(addresses.begin(), addresses.end(), host) == addresses.end())
+                    addresses.emplace_back(host);
+            }
+            freeaddrinfo(result);
+        }
+
+        std::lock_guard<std::mutex> lock{mMutex};
+        auto &connection = mConnections[index];
+        if (addresses.empty()) {
+            connection.peer = mServer;
+            return mServer;
+        }
+
+        // Prefer an address nobody is using which this connection did not just use, then one nobody is using.
+        std::shuffle(addresses.begin(), addresses.end(), mRandom);
+        auto inUse = [&](const std::string &address) {
+            return std::any_of(mConnections.begin(), mConnections.end(), [&](const Connection &other) {
+                return &other != &connection && other.peer == address;
+            });
+        };
+        auto found = std::find_if(addresses.begin(), addresses.end(), [&](const std::string &address) {
+            return !inUse(address) && address != connection.previous;
+        });
+        if (found == addresses.end())
+            found = std::find_if_not(addresses.begin(), addresses.end(), inUse);
+        connection.peer = found == addresses.end() ? addresses.front() : *found;
+        return connection.peer;
+    }
+
+    void FeedMerger::run(std::size_t index) {
+        // Signals are handled by the main thread.
+        sigset_t signals;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        auto &connection = mConnections[index];
+        std::unique_lock<std::mutex> lock{mMutex};
+        while (!mStop) {
+            lock.unlock();
+            auto address = chooseServer(index);
+            lock.lock();
+
+            APRS_IS sock{mCallSign, mPassCode, mFilter, address, mPort};
+            auto generation = mFilterGeneration;
+
+            lock.unlock();
+            bool connected = false;
+            try {
+                connected = sock.openConnection();
+            } catch (const std::exception &e) {
+                // Name resolution failures are thrown, retry as for any failed connection.
+                std::cerr << e.what() << '\n';
+            }
+            lock.lock();
+
+            if (!connected || mStop) {
+                connection.previous = address;
+                connection.peer.clear();
+                mCondition.wait_for(lock, ReconnectDelay, [this]() { return mStop; });
+                continue;
+            }
+            connection.fd = sock.fd();
+            connection.generation = generation;
+            ++connection.connects;
+
+            for (unsigned long count = 0; !mStop && count < mCycleRate; ++count) {
+                // Sent outside the lock, a server which stops reading must not stall the other connections.
+                std::string filterLine{};
+                if (connection.generation != mFilterGeneration) {
+                    connection.generation = mFilterGeneration;
+                    filterLine = "#filter " + mFilter + "\r\n";
+                }
+
+                lock.unlock();
+                if (!filterLine.empty())
+                    sock.putLine(filterLine);
+                sock.getPacket();
+                auto now = Clock::now();
+                lock.lock();
+
+                if (sock.mPacket.empty())
+                    break;
+                arrive(index, std::move(sock.mPacket), now);
+            }
+
+            std::cerr << "Disconnect " << sock.mPeerName << '\n';
+            connection.previous = address;
+            connection.fd = -1;
+            connection.peer.clear();
+            lock.unlock();
+            sock.close();
+            lock.lock();
+        }
+    }
+
+    void FeedMerger::arrive(std::size_t index, std::string packet, Clock::time_point now) {
+        if (packet.front() == '#') {
+            // Only the lowest numbered live connection passes comments on.
+            for (std::size_t other = 0; other < index; ++other)
+                if (mConnections[other].fd >= 0)
+                    return;
+        } else {
+            expire(now);
+            auto [seen, added] = mSeen.try_emplace(packetHash(packet), Seen{now, 0});
+            auto &connection = mConnections[index];
+            seen->second.servers |= 1u << index;
+            if (!added) {
+                ++connection.later;
+                auto lag = std::chrono::duration_cast<std::chrono::milliseconds>(now - seen->second.arrival);
+                connection.lag.insert(std::min(static_cast<long>(lag.count()), MaxLag));
+                return;
+            }
+            ++connection.first;
+            connection.lag.insert(0);
+            mExpiry.emplace_back(now, seen->first);
+        }
+
+        if (mQueue.size() >= MaxQueue) {
+            mQueue.pop_front();
+            ++mDropped;
+        }
+        mQueue.push_back(std::move(packet));
+        mCondition.notify_all();
+    }
+
+    void FeedMerger::expire(Clock::time_point now) {
+        while (!mExpiry.empty() && now - mExpiry.front().first > DuplicateWindow) {
+            if (auto seen = mSeen.find(mExpiry.front().second); seen != mSeen.end()) {
+                for (std::size_t index = 0; index < mConnections.size(); ++index)
+                    if ((seen->second.servers & (1u << index)) == 0)
+                        ++mConnections[index].missed;
+                mSeen.erase(seen);
+            }
+            mExpiry.pop_front();
+        }
+    }
+
+    bool FeedMerger::next(std::string &packet, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock{mMutex};
+        if (!mCondition.wait_for(lock, timeout, [this]() { return !mQueue.empty() || mStop; }) || mQueue.empty())
+            return false;
+        packet = std::move(mQueue.front());
+        mQueue.pop_front();
+        return true;
+    }
+
+    void FeedMerger::report(std::ostream &strm) {
+        std::lock_guard<std::mutex> lock{mMutex};
+        for (std::size_t index = 0; index < mConnections.size(); ++index) {
+            auto &connection = mConnections[index];
+            strm << "Feed " << index << ' ' << (connection.fd >= 0 ? connection.peer : "down")
+                 << " connects: " << connection.connects << " first: " << connection.first
+                 << " later: " << connection.later << " missed: " << connection.missed;
+            if (auto size = connection.lag.size(); size > 0)
+                strm << " lag ms median: " << connection.lag.median().value()
+                     << " p95: " << connection.lag.select(size - 1 - size / 20)
+                     << " max: " << connection.lag.select(size - 1);
+            strm << '\n';
+            connection.connects = connection.first = connection.later = connection.missed = 0;
+            connection.lag = OrderStatistic{0, MaxLag};
+        }
+        if (mDropped > 0) {
+            strm << "Feed queue full, " << mDropped << " packets dropped.\n";
+            mDropped = 0;
+        }
+    }
+}
@@ -0,0 +1,142 @@
+/**
+ * @file FeedMerger.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-23
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iosfwd>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "OrderStatistic.h"
+
+namespace aprs {
+
+    /**
+     * @class FeedMerger
+     * @brief Hold several APRS-IS connections to different servers and merge them into one feed.
+     * @details Each connection is read by its own thread. A packet is passed on from whichever server
+     * delivers it first, copies arriving from the other servers within the duplicate window are dropped.
+     * Packets are identified by a hash of the source, destination and information field, the path is left
+     * out because it is not needed to tell packets apart. Server comments are passed on from the lowest
+     * numbered connection which is up, so heartbeats arrive at the rate of one server.
+     *
+     * The connection to a server which fails, or which is cycled after the configured number of packets,
+     * is reopened while the others carry the feed, so there is no gap in the merged feed unless every
+     * connection is down at once. The server name is resolved for each connection and an address not in use
+     * by another connection, nor the one it last used, is chosen at random, so the connections are
+     * spread over the servers behind a rotating name.
+     *
+     * For each server the lag behind the first arrival of each packet is kept, zero when it was first,
+     * along with the packets it missed, so slow or lossy servers can be seen in the statistics.
+     */
+    class FeedMerger {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::size_t MaxConnections = 8;
+        static constexpr std::chrono::seconds DuplicateWindow{30};  ///< As used by the servers themselves.
+        static constexpr std::chrono::seconds ReconnectDelay{10};
+        static constexpr long MaxLag = 10000;                       ///< Milliseconds, longer lags are held here.
+        static constexpr std::size_t MaxQueue = 4096;               ///< Packets waiting to be processed.
+
+    protected:
+        /// The state and statistics of one connection.
+        struct Connection {
+            std::thread thread{};
+            std::string peer{};             ///< Server address in use or being logged in to, empty if none.
+            std::string previous{};         ///< Server address last used, avoided when reconnecting.
+            int fd{-1};                     ///< Socket while logged in, shut down to stop the reader.
+            unsigned long generation{0};    ///< Filter generation sent to the server.
+            unsigned long first{0};         ///< Packets delivered first.
+            unsigned long later{0};         ///< Packets delivered after another server.
+            unsigned long missed{0};        ///< Packets never delivered within the duplicate window.
+            unsigned long connects{0};
+            OrderStatistic lag{0, MaxLag};  ///< Milliseconds behind the first arrival.
+        };
+
+        /// Packets seen within the duplicate window.
+        struct Seen {
+            Clock::time_point arrival{};
+            std::uint32_t servers{0};       ///< Bit mask of connections which delivered the packet.
+        };
+
+        std::string mServer;
+        std::string mPort;
+        std::string mCallSign;
+        std::string mPassCode;
+        std::string mFilter;
+        unsigned long mFilterGeneration{0};
+        unsigned long mCycleRate;
+        std::vector<Connection> mConnections;
+        std::unordered_map<std::size_t, Seen> mSeen{};
+        std::deque<std::pair<Clock::time_point, std::size_t>> mExpiry{};
+        std::deque<std::string> mQueue{};
+        unsigned long mDropped{0};          ///< Packets dropped because the queue was full.
+        std::mutex mMutex{};
+        std::condition_variable mCondition{};
+        std::mt19937 mRandom{std::random_device{}()};
+        bool mStop{false};
+
+        /// Read one connection until stopped, reconnecting as needed.
+        void run(std::size_t index);
+
+        /// Resolve the server name and reserve an address for a connection, or the name if it does not resolve.
+        std::string chooseServer(std::size_t index);
+
+        /// Queue a packet unless another server delivered it first. Called with the lock held.
+        void arrive(std::size_t index, std::string packet, Clock::time_point now);
+
+        /// Forget packets older than the duplicate window. Called with the lock held.
+        void expire(Clock::time_point now);
+
+    public:
+        /**
+         * @brief Constructor, starts a reader for each connection.
+         * @param server The server name, normally one which rotates over a pool of servers.
+         * @param port The server port.
+         * @param connections The number of servers to connect to, at most MaxConnections.
+         * @param callsign The login callsign.
+         * @param passCode The login passcode.
+         * @param filter The server side filter.
+         * @param cycleRate Packets read from a server before moving to another.
+         */
+        FeedMerger(std::string server, std::string port, std::size_t connections, std::string callsign,
+                   std::string passCode, std::string filter, unsigned long cycleRate);
+
+        ~FeedMerger();
+
+        FeedMerger(const FeedMerger &) = delete;
+        FeedMerger &operator=(const FeedMerger &) = delete;
+
+        /**
+         * @brief Wait for the next packet of the merged feed.
+         * @param packet Set to the packet, a complete line.
+         * @param timeout The longest time to wait.
+         * @return false if no packet arrived in time.
+         */
+        bool next(std::string &packet, std::chrono::milliseconds timeout);
+
+        /// Change the filter on every connection without reconnecting.
+        void setFilter(const std::string &filter);
+
+        [[nodiscard]] const std::string &filter() const { return mFilter; }
+
+        /// Write the statistics of each connection and start counting again.
+        void report(std::ostream &strm);
+
+        /// Close every connection and stop the readers.
+        void stop();
+    };
+}
@@ -0,0 +1,95 @@
+/**
+ * @file FilterPlanner.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-20
+ */
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include "FilterPlanner.h"
+
+namespace aprs {
+
+    void FilterPlanner::configure(std::string range, bool budlist, std::chrono::minutes discoveryPeriod) {
+        if (range != mRange) {
+            mStations.clear();
+            mBudlistLength = 1;
+        }
+        mRange = std::move(range);
+        mBudlist = budlist;
+        mDiscoveryPeriod = std::max(discoveryPeriod, DiscoveryWindow);
+        mChanged = true;
+    }
+
+    void FilterPlanner::learn(const std::string &station) {
+        // A new station joins the budlist at the next change of filter.
+        if (auto [entry, added] = mStations.try_emplace(station, Clock::now()); added)
+            mBudlistLength += station.length() + 1;
+        else
+            entry->second = Clock::now();
+    }
+
+    void FilterPlanner::report(Clock::time_point now) {
+        std::chrono::duration<double> elapsed = now - mTraffic.start;
+        if (elapsed.count() >= 1.) {
+            auto packetRate = static_cast<double>(mTraffic.packets) / elapsed.count();
+            auto byteRate = static_cast<double>(mTraffic.bytes) / elapsed.count();
+            std::cerr << "Filter " << (mDiscovering ? "range" : "budlist") << ": " << std::fixed
+                      << std::setprecision(2) << packetRate << " packets/s " << std::setprecision(0) << byteRate
+                      << " bytes/s";
+            if (mDiscovering) {
+                mDiscoveryBytes = byteRate;
+            } else if (mDiscoveryBytes && mDiscoveryBytes.value() > 0.) {
+                std::cerr << ", " << std::setprecision(0) << 100. * (1. - byteRate / mDiscoveryBytes.value())
+                          << "% less than range";
+            }
+            std::cerr << std::defaultfloat << '\n';
+        }
+        mTraffic = Traffic{0, 0, now};
+    }
+
+    const std::string &FilterPlanner::filter() {
+        auto now = Clock::now();
+
+        if (now - mExpireTime > std::chrono::minutes(1)) {
+            mExpireTime = now;
+            for (auto it = mStations.begin(); it != mStations.end();) {
+                if (now - it->second > StationLifetime) {
+                    mBudlistLength -= it->first.length() + 1;
+                    it = mStations.erase(it);
+                    mChanged = mChanged || !mDiscovering;
+                } else {
+                    ++it;
+                }
+            }
+        }
+
+        bool newPeriod = now - mPeriodStart >= mDiscoveryPeriod;
+        if (newPeriod)
+            mPeriodStart = now;
+
+        bool discover = !mBudlist || mStations.empty() || mBudlistLength > MaxBudlist ||
+                        now - mPeriodStart < DiscoveryWindow;
+        if (discover != mDiscovering || newPeriod) {
+            report(now);
+            mChanged = mChanged || discover != mDiscovering;
+            mDiscovering = discover;
+        }
+
+        if (!mChanged)
+            return mFilter;
+        mChanged = false;
+
+        if (mDiscovering) {
+            mFilter = mRange;
+        } else {
+            mFilter = "b";
+            for (auto &station : mStations)
+                mFilter.append(1, '/').append(station.first);
+        }
+        mFilter.append(1, ' ').append(ExcludeTypes);
+        return mFilter;
+    }
+}
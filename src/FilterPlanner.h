@@ -0,0 +1,89 @@
+/**
+ * @file FilterPlanner.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-20
+ */
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace aprs {
+
+    /**
+     * @class FilterPlanner
+     * @brief Build the APRS-IS server side filter so the feed carries little more than weather.
+     * @details Packet types which never carry weather, objects, items, messages, queries, status,
+     * telemetry, user defined and NWS bulletins, are always excluded. Positions can not be excluded by type
+     * because weather stations send their reports as positions with the weather symbol.
+     *
+     * Filter terms are or'ed by the server, so a budlist can not narrow a range filter, it has to replace
+     * it. With the budlist enabled each discovery period starts with a window using the range filter, in
+     * which weather stations are learned, and continues with a budlist of the stations learned, so
+     * positions from other stations in range are not sent. New stations are picked up in the next
+     * discovery window. If nothing has been learned, or the budlist would not fit on a server command
+     * line, the range filter is used.
+     *
+     * Traffic is counted per filter so the reduction in packets and bytes per second is reported each
+     * time the filter changes, or once a discovery period when it does not.
+     */
+    class FilterPlanner {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr std::string_view ExcludeTypes = "-t/oimqstun";
+        static constexpr std::size_t MaxBudlist = 400;                  ///< Characters, server lines are 512.
+        static constexpr std::chrono::minutes DiscoveryWindow{10};
+        static constexpr std::chrono::minutes StationLifetime{120};     ///< Forget stations not heard for this.
+
+    protected:
+        /// Traffic received under one filter.
+        struct Traffic {
+            unsigned long packets{0};
+            unsigned long bytes{0};
+            Clock::time_point start{Clock::now()};
+        };
+
+        std::string mRange{};
+        bool mBudlist{false};
+        std::chrono::minutes mDiscoveryPeriod{60};
+        std::map<std::string, Clock::time_point> mStations{};      ///< Weather stations and when last heard.
+        std::size_t mBudlistLength{1};  ///< Length of the budlist term, "b" and "/station" for each station.
+        Clock::time_point mPeriodStart{Clock::now()};
+        Clock::time_point mExpireTime{Clock::now()};
+        bool mDiscovering{true};
+        bool mChanged{true};            ///< The filter must be rebuilt.
+        std::string mFilter{};
+        Traffic mTraffic{};
+        std::optional<double> mDiscoveryBytes{};    ///< Bytes per second in the last discovery window.
+
+        /// Log the traffic under the current filter and start counting again.
+        void report(Clock::time_point now);
+
+    public:
+        /**
+         * @brief Set the range filter and filter mode, the learned stations are kept if the range is unchanged.
+         * @param range The range filter, "r/lat/lon/km".
+         * @param budlist Use a budlist of learned weather stations between discovery windows.
+         * @param discoveryPeriod Time from the start of one discovery window to the next.
+         */
+        void configure(std::string range, bool budlist, std::chrono::minutes discoveryPeriod);
+
+        /// Note a station which sent a weather report.
+        void learn(const std::string &station);
+
+        /// Count a line received from the server.
+        void count(std::size_t bytes) {
+            ++mTraffic.packets;
+            mTraffic.bytes += bytes;
+        }
+
+        /// The filter to use now.
+        const std::string &filter();
+    };
+}
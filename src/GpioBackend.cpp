@@ -0,0 +1,199 @@
+/**
+ * @file GpioBackend.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-18
+ */
+
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include "GpioBackend.h"
+
+#ifdef HAVE_PIGPIO
+#include <pigpio.h>
+#endif
+
+namespace {
+    constexpr char Consumer[] = "dht";
+
+    std::int64_t monotonicMicros() {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+GpioChardev::GpioChardev(const std::filesystem::path &chip, unsigned line) : mLine{line} {
+    mChip = ::open(chip.c_str(), O_RDWR | O_CLOEXEC);
+}
+
+GpioChardev::~GpioChardev() {
+    if (mChip >= 0)
+        ::close(mChip);
+}
+
+bool GpioChardev::request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                          std::vector<GpioEdge> &edges) {
+    edges.clear();
+    if (mChip < 0)
+        return false;
+
+    // Start pulse: drive the line low, then release it to the pull up.
+    gpiohandle_request output{};
+    output.lineoffsets[0] = mLine;
+    output.lines = 1;
+    output.flags = GPIOHANDLE_REQUEST_OUTPUT;
+    output.default_values[0] = 0;
+    std::strncpy(output.consumer_label, Consumer, sizeof(output.consumer_label) - 1);
+    if (::ioctl(mChip, GPIO_GET_LINEHANDLE_IOCTL, &output) < 0)
+        return false;
+    std::this_thread::sleep_for(startLow);
+    ::close(output.fd);
+
+    // The sensor response preamble may be missed while the line is requested for events, the data bits
+    // which follow it are what matters.
+    gpioevent_request input{};
+    input.lineoffset = mLine;
+    input.handleflags = GPIOHANDLE_REQUEST_INPUT;
+    input.eventflags = GPIOEVENT_REQUEST_BOTH_EDGES;
+    std::strncpy(input.consumer_label, Consumer, sizeof(input.consumer_label) - 1);
+    if (::ioctl(mChip, GPIO_GET_LINEEVENT_IOCTL, &input) < 0)
+        return false;
+
+    auto deadline = monotonicMicros() + window.count();
+    std::array<gpioevent_data, 64> events{};
+    pollfd pfd{input.fd, POLLIN, 0};
+    for (auto now = monotonicMicros(); now < deadline; now = monotonicMicros()) {
+        auto timeout = static_cast<int>((deadline - now + 999) / 1000);
+        auto ready = ::poll(&pfd, 1, timeout);
+        if (ready < 0 && errno == EINTR)
+            continue;
+        if (ready <= 0)
+            break;
+
+        auto n = ::read(input.fd, events.data(), sizeof(events));
+        if (n < 0)
+            break;
+        for (std::size_t i = 0; i < static_cast<std::size_t>(n) / sizeof(gpioevent_data); ++i)
+            edges.push_back(GpioEdge{events[i].id == GPIOEVENT_EVENT_RISING_EDGE, events[i].timestamp / 1000});
+    }
+    ::close(input.fd);
+    return true;
+}
+
+#ifdef HAVE_PIGPIO
+
+PigpioGpio::PigpioGpio(unsigned gpio) : mGpio{gpio} {
+    mInitialised = gpioInitialise() >= 0;
+    if (mInitialised)
+        mInitialised = gpioSetAlertFuncEx(mGpio, &PigpioGpio::alert, this) == 0;
+}
+
+PigpioGpio::~PigpioGpio() {
+    if (mInitialised) {
+        gpioSetAlertFuncEx(mGpio, nullptr, nullptr);
+        gpioTerminate();
+    }
+}
+
+void PigpioGpio::alert(int, int level, std::uint32_t tick, void *self) {
+    // Level 2 is a watchdog timeout, not an edge.
+    if (level > 1)
+        return;
+    auto pigpio = static_cast<PigpioGpio *>(self);
+    std::lock_guard<std::mutex> lock{pigpio->mMutex};
+    pigpio->mCaptured.push_back(GpioEdge{level != 0, tick});
+}
+
+bool PigpioGpio::request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                         std::vector<GpioEdge> &edges) {
+    edges.clear();
+    if (!mInitialised)
+        return false;
+
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mCaptured.clear();
+    }
+    gpioSetMode(mGpio, PI_OUTPUT);
+    gpioWrite(mGpio, 0);
+    gpioDelay(static_cast<std::uint32_t>(startLow.count()));
+    gpioSetMode(mGpio, PI_INPUT);
+    gpioDelay(static_cast<std::uint32_t>(window.count()));
+
+    std::lock_guard<std::mutex> lock{mMutex};
+    edges.swap(mCaptured);
+
+    // The pigpio tick wraps every 72 minutes.
+    for (std::size_t i = 1; i < edges.size(); ++i) {
+        if (edges[i].micros < edges[i - 1].micros)
+            edges[i].micros += std::uint64_t{1} << 32;
+    }
+    return true;
+}
+
+#endif
+
+bool SimulatedGpio::load(const std::filesystem::path &path) {
+    std::ifstream strm{path};
+    if (!strm)
+        return false;
+
+    std::vector<GpioEdge> trace{};
+    std::string line{};
+    while (std::getline(strm, line)) {
+        if (line.empty() || line[0] == '#')
+            continue;
+        std::istringstream fields{line};
+        int level{};
+        std::uint64_t micros{};
+        if (fields >> level >> micros)
+            trace.push_back(GpioEdge{level != 0, micros});
+    }
+    add(std::move(trace));
+    return true;
+}
+
+std::vector<GpioEdge> SimulatedGpio::frame(const std::array<std::uint8_t, 5> &bytes) {
+    // Response: 80us low, 80us high. Each bit: 50us low then 27us high for 0 or 70us high for 1.
+    std::vector<GpioEdge> edges{};
+    std::uint64_t t{100};
+    auto edge = [&](bool level, std::uint64_t after) {
+        t += after;
+        edges.push_back(GpioEdge{level, t});
+    };
+
+    edge(false, 0);
+    edge(true, 80);
+    t += 80;
+    for (auto byte : bytes) {
+        for (int bit = 7; bit >= 0; --bit) {
+            edge(false, 0);
+            edge(true, 50);
+            t += ((byte >> bit) & 1) ? 70 : 27;
+        }
+    }
+
+    // The line is released after a final 50us low.
+    edge(false, 0);
+    edge(true, 50);
+    return edges;
+}
+
+bool SimulatedGpio::request(std::chrono::microseconds, std::chrono::microseconds, std::vector<GpioEdge> &edges) {
+    edges.clear();
+    if (mTraces.empty())
+        return false;
+    edges = mTraces.front();
+    if (mTraces.size() > 1)
+        mTraces.pop_front();
+    return true;
+}
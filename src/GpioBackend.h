@@ -0,0 +1,132 @@
+/**
+ * @file GpioBackend.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-18
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief A level change on a GPIO line.
+ */
+struct GpioEdge {
+    bool level;             ///< The level after the change.
+    std::uint64_t micros;   ///< Timestamp in microseconds, the origin is arbitrary.
+};
+
+/**
+ * @class GpioBackend
+ * @brief Access to a GPIO line for single wire sensors which answer a start pulse with a burst of edges.
+ * @details The backend drives the line low for the start time, releases it to the pull up, and records
+ * the edges the sensor sends during the capture window with timestamps taken when they happen, by the
+ * kernel or by the GPIO daemon, so the caller never polls the line.
+ */
+class GpioBackend {
+public:
+    virtual ~GpioBackend() = default;
+
+    /**
+     * @brief Send a start pulse and capture the response.
+     * @param startLow How long to hold the line low.
+     * @param window How long to capture edges after releasing the line.
+     * @param edges Receives the edges, cleared first.
+     * @return false if the line could not be driven or read.
+     */
+    virtual bool request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                         std::vector<GpioEdge> &edges) = 0;
+};
+
+/**
+ * @class GpioChardev
+ * @brief GPIO through the Linux character device, /dev/gpiochipN.
+ * @details The line is requested as an output to send the start pulse, then as an edge event source.
+ * Event timestamps are taken by the kernel in the interrupt handler, so scheduling delays in this process
+ * do not affect decoding.
+ */
+class GpioChardev : public GpioBackend {
+protected:
+    int mChip{-1};
+    unsigned mLine;
+
+public:
+    GpioChardev(const std::filesystem::path &chip, unsigned line);
+
+    ~GpioChardev() override;
+
+    GpioChardev(const GpioChardev &) = delete;
+    GpioChardev &operator=(const GpioChardev &) = delete;
+
+    [[nodiscard]] bool valid() const { return mChip >= 0; }
+
+    bool request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                 std::vector<GpioEdge> &edges) override;
+};
+
+#ifdef HAVE_PIGPIO
+
+/**
+ * @class PigpioGpio
+ * @brief GPIO through the pigpio library, edges are recorded by its alert callback.
+ */
+class PigpioGpio : public GpioBackend {
+protected:
+    unsigned mGpio;
+    bool mInitialised{false};
+    std::mutex mMutex{};
+    std::vector<GpioEdge> mCaptured{};
+
+    static void alert(int gpio, int level, std::uint32_t tick, void *self);
+
+public:
+    explicit PigpioGpio(unsigned gpio);
+
+    ~PigpioGpio() override;
+
+    PigpioGpio(const PigpioGpio &) = delete;
+    PigpioGpio &operator=(const PigpioGpio &) = delete;
+
+    [[nodiscard]] bool valid() const { return mInitialised; }
+
+    bool request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                 std::vector<GpioEdge> &edges) override;
+};
+
+#endif
+
+/**
+ * @class SimulatedGpio
+ * @brief Replay recorded or synthesised edge traces in place of a sensor.
+ * @details Each request returns the next queued trace, the last trace is repeated once the queue is down
+ * to one. Trace files hold one edge per line, the level (0 or 1) and a timestamp in microseconds; lines
+ * starting with '#' are comments.
+ */
+class SimulatedGpio : public GpioBackend {
+protected:
+    std::deque<std::vector<GpioEdge>> mTraces{};
+
+public:
+    /// Queue a trace.
+    void add(std::vector<GpioEdge> trace) { mTraces.push_back(std::move(trace)); }
+
+    /// Queue a trace read from a file, returns false if the file could not be read.
+    bool load(const std::filesystem::path &path);
+
+    /**
+     * @brief Synthesise the edges of a DHT frame.
+     * @param bytes The five frame bytes, the last is normally the checksum.
+     */
+    static std::vector<GpioEdge> frame(const std::array<std::uint8_t, 5> &bytes);
+
+    bool request(std::chrono::microseconds startLow, std::chrono::microseconds window,
+                 std::vector<GpioEdge> &edges) override;
+};
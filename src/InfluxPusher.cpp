@@ -0,0 +1,263 @@
+/**
+ * @file InfluxPusher.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-13
+ */
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <curlpp/cURLpp.hpp>
+#include <curlpp/Easy.hpp>
+#include <curlpp/Options.hpp>
+#include <curlpp/Exception.hpp>
+#include <curlpp/Infos.hpp>
+#include <zlib.h>
+#include "InfluxPusher.h"
+
+namespace {
+    /// Compress data in gzip format, returns an empty string on failure.
+    std::string gzip(const std::string &data) {
+        z_stream stream{};
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+            return {};
+
+        std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+        stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+        stream.avail_in = static_cast<uInt>(data.size());
+        stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+        stream.avail_out = static_cast<uInt>(compressed.size());
+        auto status = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        return status == Z_STREAM_END ? compressed : std::string{};
+    }
+}
+
+InfluxPusher::InfluxPusher(std::string url, Options options) : mUrl{std::move(url)}, mOptions{std::move(options)} {
+    // Pick up what a previous run could not send.
+    if (mOptions.spoolPath) {
+        std::error_code ec{};
+        auto size = std::filesystem::file_size(mOptions.spoolPath.value(), ec);
+        if (!ec)
+            mSpoolSize = static_cast<std::size_t>(size);
+    }
+    mThread = std::thread{&InfluxPusher::run, this};
+}
+
+InfluxPusher::~InfluxPusher() {
+    stop();
+}
+
+void InfluxPusher::push(std::string_view data) {
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mQueue.emplace_back(data);
+        mQueueBytes += data.size();
+
+        // The push thread normally moves overflow to the spool, but it may be waiting on a slow post.
+        while (mQueueBytes > 2 * mOptions.maxMemory && mQueue.size() > 1) {
+            mQueueBytes -= mQueue.front().size();
+            mQueue.pop_front();
+            ++mDropped;
+        }
+    }
+    mCondition.notify_one();
+}
+
+void InfluxPusher::stop() {
+    {
+        std::lock_guard<std::mutex> lock{mMutex};
+        mStop = true;
+    }
+    mCondition.notify_one();
+    if (mThread.joinable())
+        mThread.join();
+}
+
+void InfluxPusher::overflow(std::unique_lock<std::mutex> &lock) {
+    while (mQueueBytes > mOptions.maxMemory && !mQueue.empty()) {
+        auto batch = std::move(mQueue.front());
+        mQueue.pop_front();
+        mQueueBytes -= batch.size();
+
+        bool spooled{false};
+        if (mOptions.spoolPath) {
+            lock.unlock();
+            spooled = appendSpool(batch);
+            lock.lock();
+        }
+        if (!spooled)
+            ++mDropped;
+    }
+}
+
+bool InfluxPusher::appendSpool(const std::string &data) {
+    if (mSpoolSize + data.size() > mOptions.maxSpool)
+        return false;
+
+    std::ofstream strm{mOptions.spoolPath.value(), std::ios::binary | std::ios::app};
+    strm.write(data.data(), static_cast<std::streamsize>(data.size()));
+    if (!strm)
+        return false;
+    mSpoolSize += data.size();
+    return true;
+}
+
+std::string InfluxPusher::readSpool() {
+    std::string data{};
+    std::ifstream strm{mOptions.spoolPath.value(), std::ios::binary};
+    if (!strm)
+        return data;
+
+    data.resize(std::min(mOptions.maxBatch, mSpoolSize - mSpoolOffset));
+    strm.seekg(static_cast<std::streamoff>(mSpoolOffset));
+    strm.read(data.data(), static_cast<std::streamsize>(data.size()));
+    data.resize(static_cast<std::size_t>(strm.gcount()));
+
+    // Send whole lines only, unless a single line is longer than a batch.
+    if (auto eol = data.rfind('\n'); eol != std::string::npos)
+        data.resize(eol + 1);
+    return data;
+}
+
+void InfluxPusher::backoff() {
+    // Exponential backoff with jitter, so many monitors recovering together do not arrive at once.
+    ++mFailures;
+    auto shift = std::min<unsigned long>(mFailures - 1, 16);
+    auto delay = std::min<std::chrono::seconds::rep>(MinBackoff.count() << shift, MaxBackoff.count());
+    std::uniform_real_distribution<double> jitter{0.5, 1.0};
+    mRetryAt = Clock::now() + std::chrono::milliseconds{
+            static_cast<std::chrono::milliseconds::rep>(static_cast<double>(delay) * 1000. * jitter(mRandom))};
+}
+
+void InfluxPusher::run() {
+    cURLpp::Cleanup cleaner;
+    std::unique_lock<std::mutex> lock{mMutex};
+    while (true) {
+        overflow(lock);
+        if (mDropped) {
+            std::cerr << "Influx buffer full, " << mDropped << " batches dropped.\n";
+            mDropped = 0;
+        }
+
+        bool spooled = mSpoolOffset < mSpoolSize;
+        bool pending = spooled || !mQueue.empty();
+        if (mStop) {
+            // Do not wait out a backoff when stopping, what is left is spooled below.
+            if (!pending || mFailures)
+                break;
+        } else if (!pending) {
+            mCondition.wait(lock);
+            continue;
+        } else if (mFailures && Clock::now() < mRetryAt) {
+            mCondition.wait_until(lock, mRetryAt);
+            continue;
+        }
+
+        // Oldest first: the spool, then memory combined into one large batch.
+        std::string batch{};
+        if (spooled) {
+            lock.unlock();
+            batch = readSpool();
+            lock.lock();
+            if (batch.empty()) {
+                std::cerr << "Could not read influx spool " << mOptions.spoolPath.value() << ", discarded.\n";
+                mSpoolOffset = mSpoolSize;
+            }
+        } else {
+            batch = std::move(mQueue.front());
+            mQueue.pop_front();
+            while (!mQueue.empty() && batch.size() + mQueue.front().size() <= mOptions.maxBatch) {
+                batch.append(mQueue.front());
+                mQueue.pop_front();
+            }
+            mQueueBytes -= std::min(mQueueBytes, batch.size());
+        }
+
+        if (!batch.empty()) {
+            lock.unlock();
+            auto result = post(batch);
+            lock.lock();
+
+            if (result == PostResult::Failed) {
+                if (!spooled) {
+                    mQueueBytes += batch.size();
+                    mQueue.push_front(std::move(batch));
+                }
+                backoff();
+                continue;
+            }
+
+            if (mFailures) {
+                std::cerr << "Influx server reachable after " << mFailures << " failed attempts.\n";
+                mFailures = 0;
+            }
+            if (spooled)
+                mSpoolOffset += batch.size();
+        }
+
+        // Once the spool has been sent, empty it.
+        if (spooled && mSpoolOffset >= mSpoolSize) {
+            std::error_code ec{};
+            std::filesystem::resize_file(mOptions.spoolPath.value(), 0, ec);
+            mSpoolOffset = mSpoolSize = 0;
+        }
+    }
+
+    // Keep what could not be sent for the next run.
+    unsigned long lost{0};
+    while (!mQueue.empty()) {
+        auto batch = std::move(mQueue.front());
+        mQueue.pop_front();
+        lock.unlock();
+        if (!mOptions.spoolPath || !appendSpool(batch))
+            ++lost;
+        lock.lock();
+    }
+    mQueueBytes = 0;
+    if (lost)
+        std::cerr << "Influx server unreachable, " << lost << " batches lost at shutdown.\n";
+}
+
+InfluxPusher::PostResult InfluxPusher::post(const std::string &data) {
+    static constexpr long ConnectTimeout = 10;
+    static constexpr long Timeout = 60;
+
+    try {
+        cURLpp::Easy request;
+        request.setOpt(new cURLpp::Options::Url(mUrl));
+        request.setOpt(new curlpp::options::Verbose(false));
+        request.setOpt(new curlpp::options::ConnectTimeout(ConnectTimeout));
+        request.setOpt(new curlpp::options::Timeout(Timeout));
+
+        std::list<std::string> header;
+        header.emplace_back("Content-Type: application/octet-stream");
+
+        std::string compressed{};
+        if (mOptions.compress && !(compressed = gzip(data)).empty())
+            header.emplace_back("Content-Encoding: gzip");
+        auto &body = compressed.empty() ? data : compressed;
+        request.setOpt(new curlpp::options::HttpHeader(header));
+
+        request.setOpt(new curlpp::options::PostFieldSize(static_cast<long>(body.length())));
+        request.setOpt(new curlpp::options::PostFields(body));
+
+        request.perform();
+
+        // Bad data is rejected with a 4xx other than 429, resending it will not help.
+        auto code = curlpp::infos::ResponseCode::get(request);
+        if (code >= 200 && code < 300)
+            return PostResult::Ok;
+        std::cerr << "Influx server responded " << code << '\n';
+        if (code >= 400 && code < 500 && code != 429)
+            return PostResult::Rejected;
+    } catch (curlpp::LogicError &e) {
+        std::cerr << e.what() << std::endl;
+    } catch (curlpp::RuntimeError &e) {
+        std::cerr << e.what() << std::endl;
+    }
+    return PostResult::Failed;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file InfluxPusher.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-13
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+
+/**
+ * @class InfluxPusher
+ * @brief Post line protocol batches to an influx server from a background thread, riding out outages.
+ * @details The sampling thread only copies the batch into a queue, so a slow or unreachable server
+ * never delays sampling. Batches must carry their own timestamps. While the server is unreachable
+ * batches are held in memory up to a byte limit; beyond that the oldest are appended to an optional
+ * spool file, and when the spool is full or not configured the oldest are dropped. Failed posts are
+ * retried with exponential backoff and jitter. On recovery the spool, then memory, is drained in large
+ * batches. On shutdown anything still held in memory is written to the spool so it survives a restart.
+ * Batches are held and spooled as text and, if enabled, compressed as they are posted.
+ */
+class InfluxPusher {
+public:
+    struct Options {
+        std::size_t maxMemory{1024 * 1024};             ///< Bytes held in memory.
+        std::size_t maxBatch{1024 * 1024};              ///< Bytes sent in one post when catching up.
+        std::optional<std::filesystem::path> spoolPath{};   ///< Overflow file, none if not set.
+        std::size_t maxSpool{64 * 1024 * 1024};         ///< Bytes held in the spool file.
+        bool compress{false};                           ///< Post gzip compressed batches.
+    };
+
+protected:
+    using Clock = std::chrono::steady_clock;
+
+    enum class PostResult {
+        Ok,         ///< Stored.
+        Rejected,   ///< The server refused the data, retrying will not help.
+        Failed,     ///< The server could not be reached or had an error, retry later.
+    };
+
+    static constexpr std::chrono::seconds MinBackoff{1};
+    static constexpr std::chrono::seconds MaxBackoff{300};
+
+    std::string mUrl;
+    Options mOptions;
+    std::mutex mMutex{};
+    std::condition_variable mCondition{};
+    std::deque<std::string> mQueue{};
+    std::size_t mQueueBytes{0};
+    std::size_t mSpoolOffset{0};        ///< Bytes of the spool file already posted.
+    std::size_t mSpoolSize{0};          ///< Bytes in the spool file.
+    unsigned long mDropped{0};          ///< Batches dropped since last reported.
+    unsigned long mFailures{0};         ///< Consecutive failed posts.
+    Clock::time_point mRetryAt{};
+    std::mt19937 mRandom{std::random_device{}()};
+    bool mStop{false};
+    std::thread mThread{};
+
+    void run();
+
+    /// Post one batch.
+    PostResult post(const std::string &data);
+
+    /// Move batches beyond the memory limit to the spool, or drop them. Called with the lock held.
+    void overflow(std::unique_lock<std::mutex> &lock);
+
+    /// Append data to the spool file, returns false if it does not fit or could not be written.
+    bool appendSpool(const std::string &data);
+
+    /// Read up to maxBatch bytes of whole lines from the spool file.
+    std::string readSpool();
+
+    /// Schedule the next attempt after a failure.
+    void backoff();
+
+public:
+    /**
+     * @brief Constructor, starts the push thread.
+     * @param url The influx write URL including the database and precision.
+     * @param options Buffer limits and the spool file.
+     */
+    explicit InfluxPusher(std::string url, Options options);
+
+    explicit InfluxPusher(std::string url) : InfluxPusher(std::move(url), Options{}) {}
+
+    ~InfluxPusher();
+
+    InfluxPusher(const InfluxPusher &) = delete;
+    InfluxPusher &operator=(const InfluxPusher &) = delete;
+
+    /// Queue a batch for posting.
+    void push(std::string_view data);
+
+    /// Post what can be posted, spool the rest and stop the thread.
+    void stop();
+};
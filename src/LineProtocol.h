@@ -0,0 +1,133 @@
+/**
+ * @file LineProtocol.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <string_view>
+#include <charconv>
+#include <cstring>
+#include <cstdint>
+#include <optional>
+#include "Collector.h"
+
+/**
+ * @class LineProtocol
+ * @brief Encode measurements in influx line protocol into a buffer which is reused between samples.
+ * @details Consecutive fields of the same series (measurement and tag set) are written on one line.
+ * The buffer only grows, so once it has reached the size of a typical sample encoding does not allocate.
+ */
+class LineProtocol : public MetricSink {
+protected:
+    std::vector<char> mBuffer{};    ///< Encoding buffer, only grows.
+    std::size_t mSize{0};           ///< Bytes used in the buffer.
+    std::size_t mSeriesStart{0};    ///< Offset of the series key of the open line.
+    std::size_t mSeriesLength{0};   ///< Length of the series key of the open line.
+    bool mOpen{false};              ///< True if a line has been started but not terminated.
+    std::optional<std::int64_t> mTimestamp{};   ///< Written at the end of each line when set.
+    std::string mFieldSuffix{};     ///< Appended to every field name.
+
+    void reserve(std::size_t length) {
+        if (mSize + length > mBuffer.size())
+            mBuffer.resize(std::max(mBuffer.size() * 2, mSize + length));
+    }
+
+    void append(std::string_view text) {
+        reserve(text.size());
+        std::memcpy(mBuffer.data() + mSize, text.data(), text.size());
+        mSize += text.size();
+    }
+
+    void append(char c) {
+        reserve(1);
+        mBuffer[mSize++] = c;
+    }
+
+    void append(std::int64_t value) {
+        static constexpr std::size_t MaxIntegerChars = 24;
+        reserve(MaxIntegerChars);
+        auto [ptr, ec] = std::to_chars(mBuffer.data() + mSize, mBuffer.data() + mBuffer.size(), value);
+        if (ec == std::errc())
+            mSize = static_cast<std::size_t>(ptr - mBuffer.data());
+    }
+
+    void append(double value) {
+        // The shortest text which reads back as the same value, byte counts are written exactly.
+        static constexpr std::size_t MaxDoubleChars = 32;
+        reserve(MaxDoubleChars);
+        auto [ptr, ec] = std::to_chars(mBuffer.data() + mSize, mBuffer.data() + mBuffer.size(), value);
+        if (ec == std::errc())
+            mSize = static_cast<std::size_t>(ptr - mBuffer.data());
+    }
+
+public:
+    explicit LineProtocol(std::size_t capacity = 16384) : mBuffer(capacity) {}
+
+    /// Discard all encoded data, keeping the buffer.
+    void clear() {
+        mSize = 0;
+        mOpen = false;
+    }
+
+    /**
+     * @brief Set the timestamp written on lines terminated after this call.
+     * @param timestamp The time in the precision given to the server, std::nullopt to let the server
+     * use its receive time.
+     */
+    void setTimestamp(std::optional<std::int64_t> timestamp) {
+        mTimestamp = timestamp;
+    }
+
+    /**
+     * @brief Set a suffix appended to every field name, to keep these values apart from others in a series.
+     */
+    void setFieldSuffix(std::string_view suffix) {
+        mFieldSuffix = suffix;
+    }
+
+    /**
+     * @brief Add a field value.
+     * @param series The measurement and tag set, e.g. "sys,host=pi".
+     * @param field The field name.
+     * @param value The value.
+     */
+    void metric(std::string_view series, std::string_view field, double value) override {
+        if (mOpen && std::string_view{mBuffer.data() + mSeriesStart, mSeriesLength} == series) {
+            append(',');
+        } else {
+            finish();
+            mSeriesStart = mSize;
+            mSeriesLength = series.size();
+            append(series);
+            append(' ');
+            mOpen = true;
+        }
+        append(field);
+        append(mFieldSuffix);
+        append('=');
+        append(value);
+    }
+
+    /// Terminate the open line, if any.
+    void finish() {
+        if (mOpen) {
+            if (mTimestamp.has_value()) {
+                append(' ');
+                append(mTimestamp.value());
+            }
+            append('\n');
+            mOpen = false;
+        }
+    }
+
+    [[nodiscard]] bool empty() const { return mSize == 0; }
+
+    /// The encoded data, call finish() first to terminate the last line.
+    [[nodiscard]] std::string_view data() const { return {mBuffer.data(), mSize}; }
+};
@@ -0,0 +1,282 @@
+/**
+ * @file LocalSensors.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-19
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "LocalSensors.h"
+#include "Scheduler.h"
+
+namespace aprs {
+
+    namespace {
+        constexpr auto TemperatureIdx = static_cast<std::size_t>(WxSym::Temperature);
+        constexpr auto HumidityIdx = static_cast<std::size_t>(WxSym::Humidity);
+        constexpr auto PressureIdx = static_cast<std::size_t>(WxSym::Pressure);
+
+        /// Reports carry temperature in Fahrenheit as transmitted in APRS packets.
+        double celsiusToFahrenheit(double celsius) {
+            return celsius * 9. / 5. + 32.;
+        }
+
+        /// Split off the text before the first separator, or all of it.
+        std::string_view nextToken(std::string_view &text, char separator) {
+            auto end = text.find(separator);
+            auto token = text.substr(0, end);
+            text = end == std::string_view::npos ? std::string_view{} : text.substr(end + 1);
+            return token;
+        }
+
+        void sendResponse(int fd, std::string_view status) {
+            std::string response{"HTTP/1.1 "};
+            response.append(status).append("\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+            if (::send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0)
+                std::cerr << "Local sensor response: " << std::strerror(errno) << '\n';
+        }
+    }
+
+    LocalSensors::LocalSensors(Options options, const APRS_Position &qth, ReportHandler handler)
+            : mOptions{std::move(options)}, mQth{qth}, mHandler{std::move(handler)} {
+        mStopFd = ::eventfd(0, EFD_CLOEXEC);
+
+        if (mOptions.dhtChip) {
+            auto gpio = std::make_unique<GpioChardev>(mOptions.dhtChip.value(), mOptions.dhtLine);
+            if (gpio->valid())
+                mDht = std::make_unique<DhtSensor>(std::move(gpio), mOptions.dhtType);
+            else
+                std::cerr << "Could not open DHT sensor GPIO " << mOptions.dhtChip.value() << ": "
+                          << std::strerror(errno) << '\n';
+        }
+
+        if (mOptions.listenPort) {
+            mListener = std::make_unique<sockets::local_socket>("", mOptions.listenPort.value());
+            if (mListener->listen(4, AF_INET6, AF_INET, AF_UNSPEC) < 0) {
+                std::cerr << "Could not listen for local sensors on port " << mOptions.listenPort.value() << '\n';
+                mListener.reset();
+            }
+        }
+    }
+
+    LocalSensors::~LocalSensors() {
+        stop();
+        if (mStopFd >= 0)
+            ::close(mStopFd);
+    }
+
+    void LocalSensors::start() {
+        if (valid() && mStopFd >= 0 && !mThread.joinable())
+            mThread = std::thread{&LocalSensors::run, this};
+    }
+
+    void LocalSensors::stop() {
+        if (mThread.joinable()) {
+            std::uint64_t one{1};
+            if (::write(mStopFd, &one, sizeof(one)) == static_cast<ssize_t>(sizeof(one)))
+                mThread.join();
+            else
+                mThread.detach();
+        }
+    }
+
+    void LocalSensors::run() {
+        // Leave signals to the main thread.
+        sigset_t signals{};
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        PeriodicTimer timer{mOptions.interval};
+        if (!timer.valid()) {
+            std::cerr << "Local sensor timer: " << std::strerror(errno) << '\n';
+            return;
+        }
+
+        // Report straight away rather than a full interval after start up.
+        sampleDht();
+        publish();
+
+        std::array<pollfd, 3> fds{{
+                                          {mStopFd, POLLIN, 0},
+                                          {timer.fd(), POLLIN, 0},
+                                          {mListener ? mListener->fd() : -1, POLLIN, 0}
+                                  }};
+        while (true) {
+            if (::poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                std::cerr << "Local sensor poll: " << std::strerror(errno) << '\n';
+                break;
+            }
+
+            if (fds[0].revents)
+                break;
+
+            if (fds[1].revents && timer.wait()) {
+                sampleDht();
+                publish();
+            }
+
+            if (fds[2].revents & POLLIN) {
+                sockaddr_storage address{};
+                socklen_t length = sizeof(address);
+                auto fd = ::accept4(mListener->fd(), reinterpret_cast<sockaddr *>(&address), &length, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    sockets::local_socket client{fd, reinterpret_cast<sockaddr *>(&address), length};
+                    serve(client);
+                }
+            }
+        }
+    }
+
+    void LocalSensors::sampleDht() {
+        if (!mDht)
+            return;
+
+        if (auto reading = mDht->read(); reading) {
+            auto &source = mSources["dht"];
+            source.value[TemperatureIdx] = celsiusToFahrenheit(reading->temperature);
+            source.value[HumidityIdx] = reading->humidity;
+            source.time[TemperatureIdx] = source.time[HumidityIdx] = Clock::now();
+        }
+    }
+
+    void LocalSensors::serve(sockets::local_socket &client) {
+        // A slow or stalled client must not hold up sampling for long.
+        timeval timeout{RequestTimeout.count(), 0};
+        ::setsockopt(client.fd(), SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+        std::string request{};
+        auto headerEnd = std::string::npos;
+        std::size_t contentLength{0};
+        std::array<char, 4096> buffer{};
+        while (request.size() < MaxRequest) {
+            if (headerEnd != std::string::npos && request.size() >= headerEnd + contentLength)
+                break;
+
+            auto n = ::recv(client.fd(), buffer.data(), buffer.size(), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                break;
+            request.append(buffer.data(), static_cast<std::size_t>(n));
+
+            if (headerEnd == std::string::npos) {
+                if (auto blank = request.find("\r\n\r\n"); blank != std::string::npos) {
+                    headerEnd = blank + 4;
+                    std::string header{request.substr(0, blank)};
+                    std::transform(header.begin(), header.end(), header.begin(),
+                                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+                    if (auto field = header.find("\r\ncontent-length:"); field != std::string::npos)
+                        contentLength = std::strtoul(header.c_str() + field + 17, nullptr, 10);
+                }
+            }
+        }
+
+        if (headerEnd == std::string::npos || request.size() < headerEnd + contentLength) {
+            sendResponse(client.fd(), "400 Bad Request");
+        } else if (request.rfind("POST ", 0) != 0) {
+            sendResponse(client.fd(), "405 Method Not Allowed");
+        } else {
+            ingest(std::string_view{request}.substr(headerEnd, contentLength));
+            sendResponse(client.fd(), "204 No Content");
+        }
+    }
+
+    std::size_t LocalSensors::ingest(std::string_view body) {
+        std::size_t used{0};
+        while (!body.empty()) {
+            auto line = nextToken(body, '\n');
+            if (!line.empty() && line.back() == '\r')
+                line.remove_suffix(1);
+            if (line.empty() || line.front() == '#')
+                continue;
+
+            auto series = nextToken(line, ' ');
+            auto fields = nextToken(line, ' ');
+            auto tags = series;
+            if (nextToken(tags, ',') != mOptions.measurement)
+                continue;
+
+            if (!mOptions.tag.empty()) {
+                bool tagged{false};
+                while (!tags.empty() && !tagged)
+                    tagged = nextToken(tags, ',') == mOptions.tag;
+                if (!tagged)
+                    continue;
+            }
+
+            auto &source = mSources[std::string{series}];
+            auto now = Clock::now();
+            bool any{false};
+            while (!fields.empty()) {
+                auto field = nextToken(fields, ',');
+                auto name = nextToken(field, '=');
+                std::string text{field};
+                char *end{nullptr};
+                auto value = std::strtod(text.c_str(), &end);
+                if (end == text.c_str())
+                    continue;
+
+                std::size_t idx;
+                if (name == "temperature") {
+                    idx = TemperatureIdx;
+                    value = celsiusToFahrenheit(value);
+                } else if (name == "humidity") {
+                    idx = HumidityIdx;
+                } else if (name == "pressure") {
+                    idx = PressureIdx;
+                } else {
+                    continue;
+                }
+                source.value[idx] = value;
+                source.time[idx] = now;
+                any = true;
+            }
+            if (any)
+                ++used;
+        }
+        return used;
+    }
+
+    void LocalSensors::publish() {
+        auto now = Clock::now();
+        auto report = std::make_unique<APRS_WX_Report>();
+        bool any{false};
+        for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+            double sum{0.};
+            std::size_t count{0};
+            for (auto &[key, source] : mSources) {
+                if (source.value[idx] && now - source.time[idx] <= mOptions.maxAge) {
+                    sum += source.value[idx].value();
+                    ++count;
+                }
+            }
+            if (count > 0) {
+                report->mWeatherValue[idx] = sum / static_cast<double>(count);
+                any = true;
+            }
+        }
+        if (!any)
+            return;
+
+        report->mName = mOptions.name;
+        report->mSymTableId = '/';
+        report->mSymCode = '_';
+        report->mLat = mQth.mLat;
+        report->mLon = mQth.mLon;
+        report->mDistance = 0.;
+        report->mBearing = 0.;
+        report->mHannValue = mOptions.weight;
+        report->mPacketStatus = PacketStatus::WxPacket;
+        mHandler(std::move(report));
+    }
+}
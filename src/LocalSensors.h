@@ -0,0 +1,116 @@
+/**
+ * @file LocalSensors.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-19
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "APRS_Packet.h"
+#include "DhtSensor.h"
+#include "basic_socket.h"
+
+namespace aprs {
+
+    /**
+     * @class LocalSensors
+     * @brief Sensors at the QTH reported to the aggregator as a station at zero distance.
+     * @details A DHT sensor on a GPIO line is read, and ESP sensors may post line protocol to a small HTTP
+     * listener exactly as they would post to influx, e.g. "environment,sensor=esp1,room=outside
+     * temperature=21.5,humidity=60". Readings are kept per source, and on each tick of the sample timer
+     * the sources heard from within the maximum age are averaged into one report which is handed to the
+     * report handler, normally WeatherAggregator::addReport(), so local data reaches the published
+     * aggregate without waiting for remote packets. Sampling runs on its own thread, the handler is
+     * called from that thread.
+     */
+    class LocalSensors {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using ReportHandler = std::function<void(std::unique_ptr<APRS_WX_Report>)>;
+
+        struct Options {
+            std::string name{"LOCAL"};                  ///< The station name of the reports.
+            double weight{1.};                          ///< Report weight, a remote station at the QTH is 1.
+            std::chrono::seconds interval{60};          ///< Time between reports.
+            std::chrono::seconds maxAge{300};           ///< Readings older than this are not reported.
+            std::optional<std::filesystem::path> dhtChip{};     ///< GPIO chip of a DHT sensor, none if not set.
+            unsigned dhtLine{4};                        ///< GPIO line of the DHT sensor.
+            DhtType dhtType{DhtType::DHT22};
+            std::optional<std::string> listenPort{};    ///< Line protocol listener port, none if not set.
+            std::string measurement{"environment"};     ///< Only lines of this measurement are used.
+            std::string tag{};                          ///< Only lines with this tag, e.g. "room=outside".
+        };
+
+    protected:
+        static constexpr std::size_t MaxRequest = 64 * 1024;
+        static constexpr std::chrono::seconds RequestTimeout{2};
+
+        /// The latest values from one sensor, in packet units, and when each was received.
+        struct Source {
+            std::array<std::optional<double>, WeatherItemCount> value{};
+            std::array<Clock::time_point, WeatherItemCount> time{};
+        };
+
+        Options mOptions;
+        APRS_Position mQth;
+        ReportHandler mHandler;
+        std::unique_ptr<DhtSensor> mDht{};
+        std::unique_ptr<sockets::local_socket> mListener{};
+        std::map<std::string, Source> mSources{};
+        int mStopFd{-1};
+        std::thread mThread{};
+
+        void run();
+
+        void sampleDht();
+
+        /// Answer one HTTP request on an accepted connection.
+        void serve(sockets::local_socket &client);
+
+        /// Average the fresh sources into a report and hand it to the handler.
+        void publish();
+
+        /**
+         * @brief Take sensor values from a body of line protocol.
+         * @details Lines of the configured measurement with the configured tag are kept by series key. The
+         * fields temperature (Celsius), humidity (percent) and pressure (hPa) are used.
+         * @return The number of lines used.
+         */
+        std::size_t ingest(std::string_view body);
+
+    public:
+        /**
+         * @brief Constructor, opens the sensors.
+         * @param options Sensor and listener configuration.
+         * @param qth The QTH position given to the reports.
+         * @param handler Receives each report.
+         */
+        LocalSensors(Options options, const APRS_Position &qth, ReportHandler handler);
+
+        ~LocalSensors();
+
+        LocalSensors(const LocalSensors &) = delete;
+        LocalSensors &operator=(const LocalSensors &) = delete;
+
+        /// True if there is at least one sensor or listener to report from.
+        [[nodiscard]] bool valid() const { return mDht || mListener; }
+
+        /// Start the sampling thread.
+        void start();
+
+        /// Stop the sampling thread.
+        void stop();
+    };
+}
@@ -0,0 +1,122 @@
+/**
+ * @file OrderStatistic.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <optional>
+#include <cstdint>
+
+namespace aprs {
+
+    /**
+     * @class OrderStatistic
+     * @brief A counting Fenwick tree over a bounded range of integer keys.
+     * @details Weather values arrive as fixed point integers of a known number of digits so the
+     * distribution can be held as a histogram. Insert, erase, rank and select are all O(log R)
+     * where R is the size of the key range, independent of the number of stations.
+     */
+    class OrderStatistic {
+    protected:
+        long mLow{0};                       ///< The smallest key that can be stored.
+        std::vector<std::uint32_t> mTree{}; ///< Fenwick tree of key counts, 1 based.
+        std::size_t mCount{0};              ///< The number of keys stored.
+        std::size_t mTopBit{0};             ///< Largest power of two not greater than the tree size.
+
+        void update(long key, bool add) {
+            for (auto i = static_cast<std::size_t>(key - mLow) + 1; i < mTree.size(); i += i & (~i + 1)) {
+                if (add)
+                    ++mTree[i];
+                else
+                    --mTree[i];
+            }
+        }
+
+    public:
+        OrderStatistic() = default;
+
+        /**
+         * @brief Construct for keys in the closed range [low, high].
+         */
+        OrderStatistic(long low, long high) : mLow{low}, mTree(static_cast<std::size_t>(high - low) + 2, 0) {
+            for (mTopBit = 1; mTopBit * 2 < mTree.size(); mTopBit *= 2);
+        }
+
+        [[nodiscard]] std::size_t size() const { return mCount; }
+
+        [[nodiscard]] bool contains(long key) const {
+            return !mTree.empty() && key >= mLow && static_cast<std::size_t>(key - mLow) + 1 < mTree.size();
+        }
+
+        /// Add a key, keys out of range are ignored.
+        void insert(long key) {
+            if (contains(key)) {
+                update(key, true);
+                ++mCount;
+            }
+        }
+
+        /// Remove one instance of a key previously inserted.
+        void erase(long key) {
+            if (contains(key) && mCount > 0) {
+                update(key, false);
+                --mCount;
+            }
+        }
+
+        /// The number of stored keys less than or equal to key.
+        [[nodiscard]] std::size_t rank(long key) const {
+            if (mTree.empty() || key < mLow)
+                return 0;
+            auto i = std::min(static_cast<std::size_t>(key - mLow) + 1, mTree.size() - 1);
+            std::size_t sum = 0;
+            for (; i > 0; i -= i & (~i + 1))
+                sum += mTree[i];
+            return sum;
+        }
+
+        /// The k-th smallest stored key, zero based.
+        [[nodiscard]] long select(std::size_t k) const {
+            std::size_t pos = 0;
+            for (auto bit = mTopBit; bit > 0; bit /= 2) {
+                if (pos + bit < mTree.size() && mTree[pos + bit] <= k) {
+                    pos += bit;
+                    k -= mTree[pos];
+                }
+            }
+            return mLow + static_cast<long>(pos);
+        }
+
+        /// The lower median of the stored keys.
+        [[nodiscard]] std::optional<long> median() const {
+            if (mCount == 0)
+                return std::nullopt;
+            return select((mCount - 1) / 2);
+        }
+
+        /**
+         * @brief The median absolute deviation about a given median.
+         * @details Found by bisecting on the deviation d for the smallest d which has at least
+         * half of the keys within [median - d, median + d], O(log^2 R).
+         */
+        [[nodiscard]] std::optional<long> mad(long median) const {
+            if (mCount == 0)
+                return std::nullopt;
+            auto half = (mCount + 1) / 2;
+            long lo = 0, hi = static_cast<long>(mTree.size());
+            while (lo < hi) {
+                auto d = lo + (hi - lo) / 2;
+                if (rank(median + d) - rank(median - d - 1) >= half)
+                    hi = d;
+                else
+                    lo = d + 1;
+            }
+            return lo;
+        }
+    };
+}
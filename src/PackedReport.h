@@ -0,0 +1,199 @@
+/**
+ * @file PackedReport.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-25
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_set>
+
+#include "APRS_Packet.h"
+
+namespace aprs {
+
+    /// True if a packed weather item is held in 32 bits, too many digits for 16 bits.
+    constexpr bool packedWide(std::size_t idx) {
+        return WeatherItemList[idx].digits > static_cast<std::size_t>(std::numeric_limits<std::int16_t>::digits10);
+    }
+
+    /// The index of a packed weather item among the items of the same width.
+    constexpr std::size_t packedSlot(std::size_t idx) {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < idx; ++i)
+            if (packedWide(i) == packedWide(idx))
+                ++n;
+        return n;
+    }
+
+    /// The number of weather items held in 32 bits.
+    constexpr std::size_t packedWideCount() {
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < WeatherItemCount; ++i)
+            if (packedWide(i))
+                ++n;
+        return n;
+    }
+
+    /**
+     * @class StationNames
+     * @brief One copy of each station name, shared by everything which refers to the station.
+     * @details Names are never removed so references stay valid, the set is bounded by the number of
+     * stations ever heard within the filter.
+     */
+    class StationNames {
+    protected:
+        std::unordered_set<std::string> mNames{};
+
+    public:
+        const std::string &intern(const std::string &name) {
+            if (auto found = mNames.find(name); found != mNames.end())
+                return *found;
+            return *mNames.insert(name).first;
+        }
+
+        [[nodiscard]] std::size_t size() const { return mNames.size(); }
+    };
+
+    /**
+     * @class PackedReport
+     * @brief A station weather report as held by the aggregator, a fraction of the size of APRS_WX_Report.
+     * @details Weather values are held as the integer transmitted, the value times WeatherItem::factor, in
+     * 16 bits or in 32 bits for items with more digits than 16 bits can hold, with a bit mask of the values
+     * present. Position is held in micro degrees, distance, bearing and weight as floats, and the name as a
+     * reference to the interned name. Values decoded from compressed or Mic-E wind, or averaged from local
+     * sensors, are rounded to the resolution of the packet format.
+     */
+    class PackedReport {
+    public:
+        using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+    protected:
+        static constexpr double MicroDegrees = 1e6;
+
+        static_assert(WeatherItemCount <= 16, "Value bit masks hold 16 items.");
+
+        TimePoint mTimePoint{};
+        const std::string *mName{nullptr};
+        std::int32_t mLat{0}, mLon{0};
+        float mDistance{std::numeric_limits<float>::quiet_NaN()};
+        float mBearing{std::numeric_limits<float>::quiet_NaN()};
+        float mHannValue{0.f};
+        std::array<std::int16_t, WeatherItemCount - packedWideCount()> mNarrow{};
+        std::array<std::int32_t, packedWideCount()> mWide{};
+        std::uint16_t mValid{0};
+        std::uint16_t mRejected{0};
+
+    public:
+        char mSymTableId{}, mSymCode{};
+
+        PackedReport() = default;
+
+        /**
+         * @brief Pack a decoded report.
+         * @param report A report with a position.
+         * @param name The interned name of the station.
+         */
+        PackedReport(const APRS_WX_Report &report, const std::string &name)
+                : mTimePoint{report.mTimePoint}, mName{&name}, mSymTableId{report.mSymTableId},
+                  mSymCode{report.mSymCode} {
+            setPosition(report);
+            for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+                if (report.mWeatherValue[idx].has_value())
+                    setKey(idx, std::lround(report.mWeatherValue[idx].value() * WeatherItemList[idx].factor));
+                if (report.mRejected[idx])
+                    setRejected(idx, true);
+            }
+        }
+
+        [[nodiscard]] const std::string &name() const { return *mName; }
+
+        [[nodiscard]] TimePoint timePoint() const { return mTimePoint; }
+
+        [[nodiscard]] bool has(std::size_t idx) const { return (mValid & (1u << idx)) != 0; }
+
+        /// The value as transmitted, the weather value times the item factor.
+        [[nodiscard]] long key(std::size_t idx) const {
+            return packedWide(idx) ? mWide[packedSlot(idx)] : mNarrow[packedSlot(idx)];
+        }
+
+        void setKey(std::size_t idx, long key) {
+            if (packedWide(idx))
+                mWide[packedSlot(idx)] = static_cast<std::int32_t>(std::clamp<long>(
+                        key, std::numeric_limits<std::int32_t>::min(), std::numeric_limits<std::int32_t>::max()));
+            else
+                mNarrow[packedSlot(idx)] = static_cast<std::int16_t>(std::clamp<long>(
+                        key, std::numeric_limits<std::int16_t>::min(), std::numeric_limits<std::int16_t>::max()));
+            mValid = static_cast<std::uint16_t>(mValid | (1u << idx));
+        }
+
+        [[nodiscard]] std::optional<double> value(std::size_t idx) const {
+            if (!has(idx))
+                return std::nullopt;
+            return static_cast<double>(key(idx)) / WeatherItemList[idx].factor;
+        }
+
+        [[nodiscard]] bool rejected(std::size_t idx) const { return (mRejected & (1u << idx)) != 0; }
+
+        [[nodiscard]] std::uint16_t rejectedMask() const { return mRejected; }
+
+        void setRejected(std::size_t idx, bool rejected) {
+            if (rejected)
+                mRejected = static_cast<std::uint16_t>(mRejected | (1u << idx));
+            else
+                mRejected = static_cast<std::uint16_t>(mRejected & ~(1u << idx));
+        }
+
+        void clearRejected() { mRejected = 0; }
+
+        [[nodiscard]] double lat() const { return mLat / MicroDegrees; }
+
+        [[nodiscard]] double lon() const { return mLon / MicroDegrees; }
+
+        [[nodiscard]] std::optional<double> distance() const {
+            if (std::isnan(mDistance))
+                return std::nullopt;
+            return mDistance;
+        }
+
+        [[nodiscard]] std::optional<double> bearing() const {
+            if (std::isnan(mBearing))
+                return std::nullopt;
+            return mBearing;
+        }
+
+        [[nodiscard]] double hannValue() const { return mHannValue; }
+
+        /// Set position, distance, bearing and weight from a position.
+        void setPosition(const APRS_Position &position) {
+            mLat = static_cast<std::int32_t>(std::lround(position.mLat.value_or(0.) * MicroDegrees));
+            mLon = static_cast<std::int32_t>(std::lround(position.mLon.value_or(0.) * MicroDegrees));
+            mDistance = position.mDistance ? static_cast<float>(position.mDistance.value())
+                                           : std::numeric_limits<float>::quiet_NaN();
+            mBearing = position.mBearing ? static_cast<float>(position.mBearing.value())
+                                         : std::numeric_limits<float>::quiet_NaN();
+            mHannValue = static_cast<float>(position.mHannValue.value_or(0.));
+        }
+
+        /// The position, distance, bearing and weight.
+        [[nodiscard]] APRS_Position position() const {
+            APRS_Position position{};
+            position.mName = name();
+            position.mLat = lat();
+            position.mLon = lon();
+            position.mDistance = distance();
+            position.mBearing = bearing();
+            position.mHannValue = mHannValue;
+            return position;
+        }
+    };
+}
@@ -0,0 +1,135 @@
+/**
+ * @file PacketClassifier.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-21
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace aprs {
+
+    /**
+     * @brief What a line from the server holds, decided before decoding.
+     */
+    enum class PacketClass : std::uint8_t {
+        Comment,        ///< Server comment or heartbeat, the line starts with '#'.
+        Weather,        ///< Position with the weather symbol, positionless weather or Mic-E weather.
+        Position,       ///< Position of a station which is not a weather station.
+        Other,          ///< A data type which is not decoded.
+        Malformed,      ///< No source, information field or symbol where one is needed.
+    };
+
+    static constexpr std::size_t PacketClassCount = static_cast<std::size_t>(PacketClass::Malformed) + 1;
+
+    /**
+     * @brief The result of classifying a line, views into the line.
+     */
+    struct PacketClassification {
+        PacketClass packetClass{PacketClass::Malformed};
+        std::string_view name{};            ///< Source callsign.
+        std::string_view destination{};     ///< Destination, carries the latitude of Mic-E packets.
+        std::size_t info{0};                ///< Index of the data type identifier.
+        char dti{'\0'};                     ///< The data type identifier.
+    };
+
+    /**
+     * @class PacketClassifier
+     * @brief Find the class of a packet from its raw line without decoding it.
+     * @details The '>' and ':' delimiters are found with memchr, which the C library implements with
+     * vector instructions, and the symbol code is read at the offset fixed by the data type identifier
+     * and position format. Nothing is allocated, so the bulk of the traffic which is not weather is
+     * rejected for the cost of two short scans. The classification carries what the decoder needs to
+     * start at the information field.
+     */
+    class PacketClassifier {
+    protected:
+        std::array<unsigned long, PacketClassCount> mCount{};
+
+        static PacketClassification classifyLine(std::string_view line) {
+            PacketClassification result{};
+            if (line.empty())
+                return result;
+            if (line.front() == '#') {
+                result.packetClass = PacketClass::Comment;
+                return result;
+            }
+
+            auto begin = line.data();
+            auto end = begin + line.size();
+            auto gt = static_cast<const char *>(std::memchr(begin, '>', line.size()));
+            if (gt == nullptr || gt == begin)
+                return result;
+            auto colon = static_cast<const char *>(std::memchr(gt, ':', static_cast<std::size_t>(end - gt)));
+            if (colon == nullptr || colon + 1 >= end)
+                return result;
+            auto comma = static_cast<const char *>(std::memchr(gt, ',', static_cast<std::size_t>(colon - gt)));
+
+            result.name = std::string_view{begin, static_cast<std::size_t>(gt - begin)};
+            result.destination = std::string_view{gt + 1, static_cast<std::size_t>((comma ? comma : colon) - gt - 1)};
+            result.info = static_cast<std::size_t>(colon + 1 - begin);
+            result.dti = colon[1];
+
+            // Offset of the symbol code from the information field.
+            std::size_t symbol;
+            switch (result.dti) {
+                case '!':
+                case '=':
+                case '@':
+                case '/': {
+                    // Timestamped positions carry 7 characters of time before the position.
+                    auto position = result.info + ((result.dti == '@' || result.dti == '/') ? 8 : 1);
+                    if (position >= line.size())
+                        return result;
+                    // Uncompressed: DDMM.mmN table DDDMM.mmW code. Compressed: table YYYY XXXX code.
+                    auto c = line[position];
+                    symbol = position + ((c >= '0' && c <= '9') || c == ' ' ? 18 : 9);
+                    break;
+                }
+                case '_':
+                    result.packetClass = PacketClass::Weather;
+                    return result;
+                case '`':
+                case '\'':
+                case '\x1c':
+                case '\x1d':
+                    // Mic-E: longitude, speed and course in 6 bytes, then the code.
+                    symbol = result.info + 7;
+                    break;
+                case '\n':
+                case '\r':
+                    return result;
+                default:
+                    result.packetClass = PacketClass::Other;
+                    return result;
+            }
+
+            if (symbol < line.size())
+                result.packetClass = line[symbol] == '_' ? PacketClass::Weather : PacketClass::Position;
+            return result;
+        }
+
+    public:
+        /// Classify a line and count it.
+        PacketClassification classify(std::string_view line) {
+            auto result = classifyLine(line);
+            ++mCount[static_cast<std::size_t>(result.packetClass)];
+            return result;
+        }
+
+        [[nodiscard]] unsigned long count(PacketClass packetClass) const {
+            return mCount[static_cast<std::size_t>(packetClass)];
+        }
+
+        static constexpr std::string_view className(PacketClass packetClass) {
+            constexpr std::array<std::string_view, PacketClassCount> Names{
+                    "comment", "weather", "position", "other", "malformed"};
+            return Names[static_cast<std::size_t>(packetClass)];
+        }
+    };
+}
@@ -0,0 +1,85 @@
+/**
+ * @file PacketPool.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-24
+ */
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "APRS_Packet.h"
+
+namespace aprs {
+
+    /**
+     * @class PacketPool
+     * @brief Recycled slots for decoded packets, so decoding does not allocate a packet per line.
+     * @details A slot is a unique_ptr whose deleter returns the packet to the pool, so a slot can be filled
+     * on one thread, moved to another and released there. The pool grows by one slot when every slot is in
+     * use, so after start up the number of slots settles at the most ever in flight and no further
+     * allocation is made. A released packet is overwritten by the next decode, callsigns and timestamps
+     * fit the small string buffer so refilling a slot does not allocate. The pool must outlive every slot
+     * taken from it.
+     */
+    class PacketPool {
+    public:
+        /// Returns a packet to its pool.
+        struct Recycle {
+            PacketPool *pool{nullptr};
+
+            void operator()(DecodedPacket *packet) const noexcept {
+                pool->release(packet);
+            }
+        };
+
+        using Slot = std::unique_ptr<DecodedPacket, Recycle>;
+
+    protected:
+        std::mutex mMutex{};
+        std::deque<DecodedPacket> mPackets{};       ///< Every slot, a deque so growing does not move them.
+        std::vector<DecodedPacket *> mFree{};
+
+        void release(DecodedPacket *packet) noexcept {
+            std::lock_guard<std::mutex> lock{mMutex};
+            mFree.push_back(packet);
+        }
+
+    public:
+        /**
+         * @brief Constructor
+         * @param slots The number of slots to create at once.
+         */
+        explicit PacketPool(std::size_t slots = 4) {
+            mFree.reserve(slots);
+            for (std::size_t n = 0; n < slots; ++n)
+                mFree.push_back(&mPackets.emplace_back());
+        }
+
+        PacketPool(const PacketPool &) = delete;
+        PacketPool &operator=(const PacketPool &) = delete;
+
+        /// Take a free slot, growing the pool if there is none.
+        Slot acquire() {
+            std::lock_guard<std::mutex> lock{mMutex};
+            if (mFree.empty()) {
+                auto packet = &mPackets.emplace_back();
+                mFree.reserve(mPackets.size());
+                return Slot{packet, Recycle{this}};
+            }
+            auto packet = mFree.back();
+            mFree.pop_back();
+            return Slot{packet, Recycle{this}};
+        }
+
+        /// The number of slots created.
+        [[nodiscard]] std::size_t size() {
+            std::lock_guard<std::mutex> lock{mMutex};
+            return mPackets.size();
+        }
+    };
+}
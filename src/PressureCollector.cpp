@@ -0,0 +1,106 @@
+/**
+ * @file PressureCollector.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-15
+ */
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include "PressureCollector.h"
+
+namespace {
+    /// Parse the decimal value following a key such as "avg10=".
+    std::optional<double> decimalValue(std::string_view line, std::string_view key) {
+        auto p = line.find(key);
+        if (p == std::string_view::npos)
+            return std::nullopt;
+        line.remove_prefix(p + key.size());
+        double value{};
+        if (std::from_chars(line.data(), line.data() + line.size(), value).ec != std::errc())
+            return std::nullopt;
+        return value;
+    }
+}
+
+PressureCollector::PressureCollector(std::string_view host, std::optional<long> triggerStall) {
+    mResourceList.reserve(mResources.size());
+    for (auto name : mResources) {
+        std::string path{"/proc/pressure/"};
+        path.append(name);
+        auto &resource = mResourceList.emplace_back(path);
+        resource.mTotal.mSeries = "pressure,host=" + std::string{host} + ",resource=" + std::string{name};
+
+        if (triggerStall.has_value()) {
+            auto trigger = "some " + std::to_string(triggerStall.value()) + ' ' + std::to_string(TriggerWindow);
+            resource.mTriggerFd = ::open(path.c_str(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+            if (resource.mTriggerFd >= 0 &&
+                ::write(resource.mTriggerFd, trigger.c_str(), trigger.size() + 1) < 0) {
+                ::close(resource.mTriggerFd);
+                resource.mTriggerFd = -1;
+            }
+            if (resource.mTriggerFd < 0)
+                std::cerr << "Could not register pressure trigger on " << path << ": " << std::strerror(errno) << '\n';
+        }
+    }
+}
+
+PressureCollector::~PressureCollector() {
+    for (auto &resource : mResourceList) {
+        if (resource.mTriggerFd >= 0)
+            ::close(resource.mTriggerFd);
+    }
+}
+
+void PressureCollector::triggerFds(std::vector<int> &fds) const {
+    for (auto &resource : mResourceList) {
+        if (resource.mTriggerFd >= 0)
+            fds.push_back(resource.mTriggerFd);
+    }
+}
+
+bool PressureCollector::sample(MetricSink &sink) {
+    static constexpr std::array<std::string_view, ItemCount> Keys{"avg10=", "avg60="};
+
+    auto interval = mClock.lap();
+    bool ok = true;
+    for (auto &resource : mResourceList) {
+        auto content = resource.mFile.read();
+        if (!content.has_value()) {
+            ok = false;
+            continue;
+        }
+
+        // "some avg10=0.00 avg60=0.00 avg300=0.00 total=0" then the same for "full", which older kernels
+        // do not provide for cpu.
+        auto view = content.value();
+        while (!view.empty()) {
+            auto line = nextLine(view);
+            Line kind;
+            if (line.rfind("some", 0) == 0)
+                kind = Some;
+            else if (line.rfind("full", 0) == 0)
+                kind = Full;
+            else
+                continue;
+
+            for (std::size_t idx = 0; idx < ItemCount; ++idx) {
+                if (auto value = decimalValue(line, Keys[idx]); value.has_value())
+                    resource.mAverage[kind][idx].update(sink, resource.mTotal.mSeries, mFields[kind][idx],
+                                                        value.value());
+            }
+
+            if (auto p = line.find("total="); p != std::string_view::npos) {
+                line.remove_prefix(p);
+                resource.mTotal.mCounter[kind] = nextNumber(line).value_or(0);
+            }
+        }
+
+        // Microseconds stalled per second of interval, as a percentage.
+        resource.mTotal.sendRates(sink, mStallFields, interval, 1.e-4);
+    }
+    return ok;
+}
@@ -0,0 +1,74 @@
+/**
+ * @file PressureCollector.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-15
+ */
+
+#pragma once
+
+#include <array>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Collector.h"
+#include "ProcFile.h"
+#include "SystemCollectors.h"
+
+/**
+ * @class PressureCollector
+ * @brief Pressure Stall Information for cpu, memory and io from /proc/pressure.
+ * @details The some and full avg10 and avg60 values are sent as read, the total stall time is sent as the
+ * percentage of the sample interval stalled. Metrics are sent on "pressure,host=H,resource=R".
+ * When a trigger threshold is given a PSI trigger is registered on each resource. The trigger
+ * descriptors are returned by triggerFds() for the caller to poll for POLLPRI, the kernel only
+ * signals them when the stall time in a window crosses the threshold so they cost nothing until then.
+ */
+class PressureCollector : public Collector {
+public:
+    static constexpr long TriggerWindow = 2000000;  ///< Trigger window in microseconds, unprivileged minimum.
+
+protected:
+    enum Line {
+        Some, Full, LineCount
+    };
+
+    enum Item {
+        Avg10, Avg60, ItemCount
+    };
+
+    static constexpr std::array<std::string_view, 3> mResources{"cpu", "memory", "io"};
+    static constexpr std::array<std::array<std::string_view, ItemCount>, LineCount> mFields{{
+            {"someAvg10", "someAvg60"}, {"fullAvg10", "fullAvg60"}}};
+    static constexpr std::array<std::string_view, LineCount> mStallFields{"someStall", "fullStall"};
+
+    struct Resource {
+        ProcFile mFile;
+        CounterSet<LineCount> mTotal{};
+        std::array<std::array<Gauge, ItemCount>, LineCount> mAverage{};
+        int mTriggerFd{-1};
+
+        explicit Resource(std::string path) : mFile{std::move(path), 512} {}
+    };
+
+    std::vector<Resource> mResourceList{};
+    RateClock mClock{};
+
+public:
+    /**
+     * @brief Constructor
+     * @param host The host name used to tag measurements.
+     * @param triggerStall If set, register a trigger on the "some" stall time of each resource, in
+     * microseconds per TriggerWindow.
+     */
+    PressureCollector(std::string_view host, std::optional<long> triggerStall);
+
+    ~PressureCollector() override;
+
+    PressureCollector(const PressureCollector &) = delete;
+    PressureCollector &operator=(const PressureCollector &) = delete;
+
+    bool sample(MetricSink &sink) override;
+
+    void triggerFds(std::vector<int> &fds) const override;
+};
@@ -0,0 +1,106 @@
+/**
+ * @file ProcFile.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <optional>
+#include <vector>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+/**
+ * @class ProcFile
+ * @brief A /proc or /sys file held open and re-read with pread(2) into a fixed buffer.
+ * @details Kernel pseudo files regenerate their content on every read from offset zero, so one open file
+ * descriptor serves every sample without the cost of open(2), close(2) or any stream buffers. If a read
+ * fails the file is reopened once, which handles files that are replaced, such as hot plugged devices.
+ */
+class ProcFile {
+protected:
+    std::string mPath{};            ///< The file path.
+    int mFd{-1};                    ///< The open file descriptor, -1 if not open.
+    std::vector<char> mBuffer{};    ///< Read buffer, the file content beyond its size is not read.
+
+    std::optional<std::string_view> readOnce() {
+        if (mFd < 0 && !open())
+            return std::nullopt;
+
+        ssize_t n;
+        do {
+            n = ::pread(mFd, mBuffer.data(), mBuffer.size(), 0);
+        } while (n < 0 && errno == EINTR);
+
+        if (n < 0)
+            return std::nullopt;
+        return std::string_view{mBuffer.data(), static_cast<std::size_t>(n)};
+    }
+
+public:
+    explicit ProcFile(std::string path, std::size_t bufferSize = 4096) : mPath{std::move(path)}, mBuffer(bufferSize) {}
+
+    ~ProcFile() {
+        close();
+    }
+
+    ProcFile(const ProcFile &) = delete;
+
+    ProcFile &operator=(const ProcFile &) = delete;
+
+    ProcFile(ProcFile &&other) noexcept : mPath{std::move(other.mPath)}, mFd{other.mFd},
+                                          mBuffer{std::move(other.mBuffer)} {
+        other.mFd = -1;
+    }
+
+    ProcFile &operator=(ProcFile &&other) noexcept {
+        if (this != &other) {
+            close();
+            mPath = std::move(other.mPath);
+            mBuffer = std::move(other.mBuffer);
+            mFd = other.mFd;
+            other.mFd = -1;
+        }
+        return *this;
+    }
+
+    /// Open the file read only, returns true on success.
+    bool open() {
+        close();
+        mFd = ::open(mPath.c_str(), O_RDONLY | O_CLOEXEC);
+        return mFd >= 0;
+    }
+
+    void close() {
+        if (mFd >= 0) {
+            ::close(mFd);
+            mFd = -1;
+        }
+    }
+
+    [[nodiscard]] bool isOpen() const { return mFd >= 0; }
+
+    [[nodiscard]] int fd() const { return mFd; }
+
+    [[nodiscard]] const std::string &path() const { return mPath; }
+
+    /**
+     * @brief Read the current content of the file.
+     * @return A view of the content in the internal buffer, valid until the next read, or std::nullopt
+     * if the file could not be read.
+     */
+    std::optional<std::string_view> read() {
+        if (auto data = readOnce(); data.has_value())
+            return data;
+
+        // Reopen once in case the file has been replaced.
+        if (open())
+            return readOnce();
+        return std::nullopt;
+    }
+};
@@ -0,0 +1,180 @@
+/**
+ * @file ProcessCollector.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-14
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "ProcessCollector.h"
+
+ProcessCollector::ProcessCollector(std::string_view host, std::size_t topN)
+        : mHost{host}, mTopN{std::max<std::size_t>(topN, 1)},
+          mTicksPerSecond{static_cast<double>(::sysconf(_SC_CLK_TCK))},
+          mPageSize{static_cast<double>(::sysconf(_SC_PAGESIZE))} {
+    mProcDir = ::opendir("/proc");
+    mProcesses.reserve(512);
+    mCandidates.reserve(512);
+    mReported.reserve(2 * mTopN);
+}
+
+ProcessCollector::~ProcessCollector() {
+    if (mProcDir)
+        ::closedir(mProcDir);
+}
+
+std::optional<std::string_view> ProcessCollector::readProcFile(const char *path) {
+    int fd = ::openat(::dirfd(mProcDir), path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return std::nullopt;
+
+    ssize_t n;
+    do {
+        n = ::read(fd, mBuffer.data(), mBuffer.size());
+    } while (n < 0 && errno == EINTR);
+    ::close(fd);
+
+    if (n <= 0)
+        return std::nullopt;
+    return std::string_view{mBuffer.data(), static_cast<std::size_t>(n)};
+}
+
+bool ProcessCollector::sample(MetricSink &sink) {
+    // Fields of /proc/[pid]/stat after the command, counted from ppid which is the first number.
+    static constexpr std::size_t UTimeIndex = 10;
+    static constexpr std::size_t STimeIndex = 11;
+    static constexpr std::size_t StartTimeIndex = 18;
+    static constexpr std::size_t RssIndex = 20;
+
+    if (!mProcDir)
+        return false;
+
+    auto interval = mClock.lap();
+    ++mGeneration;
+    mCandidates.clear();
+
+    ::rewinddir(mProcDir);
+    while (auto entry = ::readdir(mProcDir)) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9')
+            continue;
+        pid_t pid{};
+        std::string_view name{entry->d_name};
+        if (std::from_chars(name.data(), name.data() + name.size(), pid).ec != std::errc())
+            continue;
+
+        std::array<char, 32> path{};
+
+        // The process may exit at any point, a failed read just skips it.
+        std::snprintf(path.data(), path.size(), "%d/stat", pid);
+        auto stat = readProcFile(path.data());
+        if (!stat.has_value())
+            continue;
+        auto open = stat->find('(');
+        auto close = stat->rfind(')');
+        if (open == std::string_view::npos || close == std::string_view::npos || close < open)
+            continue;
+        auto comm = stat->substr(open + 1, close - open - 1);
+        auto fields = stat->substr(close + 1);
+
+        unsigned long long ticks{}, startTime{}, rssPages{};
+        for (std::size_t idx = 0; idx <= RssIndex; ++idx) {
+            auto value = nextNumber(fields).value_or(0);
+            if (idx == UTimeIndex || idx == STimeIndex)
+                ticks += value;
+            else if (idx == StartTimeIndex)
+                startTime = value;
+            else if (idx == RssIndex)
+                rssPages = value;
+        }
+
+        auto [iterator, added] = mProcesses.try_emplace(pid);
+        auto &process = iterator->second;
+        if (!added && process.mStartTime != startTime)
+            added = true;
+        if (added || process.mComm != comm) {
+            process.mComm = comm;
+            process.mSeries = "proc,host=" + mHost + ",name=" + escapeTag(comm);
+        }
+
+        // A process started since the last sample used all of its time in this interval.
+        auto previousTicks = added ? (mGeneration > 1 ? 0 : ticks) : process.mTicks;
+        process.mTicks = ticks;
+        process.mStartTime = startTime;
+        process.mGeneration = mGeneration;
+
+        auto rss = static_cast<double>(rssPages) * mPageSize;
+        double cpu = 0.;
+        if (interval > 0. && ticks >= previousTicks)
+            cpu = 100. * static_cast<double>(ticks - previousTicks) / (interval * mTicksPerSecond);
+
+        mCandidates.push_back(Candidate{pid, cpu, rss, &process, 1, cpu});
+    }
+
+    // Forget processes which have exited.
+    for (auto it = mProcesses.begin(); it != mProcesses.end();) {
+        if (it->second.mGeneration != mGeneration)
+            it = mProcesses.erase(it);
+        else
+            ++it;
+    }
+
+    // The first sample only establishes the cpu time baseline.
+    if (mGeneration == 1)
+        return true;
+
+    // Processes sharing a name share a series, add them together in place.
+    std::sort(mCandidates.begin(), mCandidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.process->mSeries < b.process->mSeries;
+    });
+    std::size_t groups = 0;
+    for (auto &candidate : mCandidates) {
+        if (groups > 0 && mCandidates[groups - 1].process->mSeries == candidate.process->mSeries) {
+            auto &group = mCandidates[groups - 1];
+            if (candidate.busiest > group.busiest) {
+                group.pid = candidate.pid;
+                group.busiest = candidate.busiest;
+            }
+            group.cpu += candidate.cpu;
+            group.rss += candidate.rss;
+            ++group.count;
+        } else {
+            mCandidates[groups++] = candidate;
+        }
+    }
+    mCandidates.erase(mCandidates.begin() + static_cast<std::ptrdiff_t>(groups), mCandidates.end());
+
+    // A name in the top N by both CPU and memory is reported once.
+    mReported.clear();
+    auto report = [this](auto begin, auto end) {
+        for (auto it = begin; it != end; ++it) {
+            if (std::none_of(mReported.begin(), mReported.end(), [it](const Candidate &c) {
+                return c.process == it->process;
+            }))
+                mReported.push_back(*it);
+        }
+    };
+
+    auto topN = std::min(mTopN, mCandidates.size());
+    auto middle = mCandidates.begin() + static_cast<std::ptrdiff_t>(topN);
+    std::partial_sort(mCandidates.begin(), middle, mCandidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.cpu > b.cpu;
+    });
+    report(mCandidates.begin(), middle);
+
+    std::partial_sort(mCandidates.begin(), middle, mCandidates.end(), [](const Candidate &a, const Candidate &b) {
+        return a.rss > b.rss;
+    });
+    report(mCandidates.begin(), middle);
+
+    for (auto &candidate : mReported) {
+        sink.metric(candidate.process->mSeries, "cpu", candidate.cpu);
+        sink.metric(candidate.process->mSeries, "rss", candidate.rss);
+        sink.metric(candidate.process->mSeries, "count", static_cast<double>(candidate.count));
+        sink.label(candidate.process->mSeries, "pid", static_cast<double>(candidate.pid));
+    }
+    return true;
+}
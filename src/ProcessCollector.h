@@ -0,0 +1,82 @@
+/**
+ * @file ProcessCollector.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-14
+ */
+
+#pragma once
+
+#include <array>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <dirent.h>
+#include <sys/types.h>
+#include "Collector.h"
+#include "SystemCollectors.h"
+
+/**
+ * @class ProcessCollector
+ * @brief Report the processes using the most CPU and memory.
+ * @details Each sample makes one pass over the /proc directory stream, which is kept open and rewound,
+ * and reads /proc/[pid]/stat into a fixed buffer relative to the /proc directory descriptor. The stat file
+ * carries the resident set size as well as the cpu times, so /proc/[pid]/statm is not needed and each
+ * process costs one open, read and close. CPU time is kept in a pid indexed table to compute per process rates, a pid reused by a
+ * new process is detected by its start time. Processes sharing a name are added together, so many workers
+ * of one name are seen as the load they make together. The top N names by CPU and the top N by resident
+ * memory are sent on the series "proc,host=H,name=COMM" with fields cpu (percent of one core), rss (bytes)
+ * and count (processes), and the label pid of the busiest process of the name.
+ */
+class ProcessCollector : public Collector {
+protected:
+    struct Process {
+        unsigned long long mTicks{};        ///< User plus system time in clock ticks.
+        unsigned long long mStartTime{};    ///< Start time, to detect pid reuse.
+        unsigned long mGeneration{};        ///< Sample in which the process was last seen.
+        std::string mComm{};
+        std::string mSeries{};
+    };
+
+    /// A process, or once grouped, the processes sharing a name.
+    struct Candidate {
+        pid_t pid;                  ///< The busiest process.
+        double cpu;
+        double rss;
+        const Process *process;
+        std::size_t count;
+        double busiest;             ///< CPU of the busiest process.
+    };
+
+    std::string mHost{};
+    std::size_t mTopN;
+    DIR *mProcDir{nullptr};
+    std::unordered_map<pid_t, Process> mProcesses{};
+    std::vector<Candidate> mCandidates{};
+    std::vector<Candidate> mReported{};
+    std::array<char, 1024> mBuffer{};
+    unsigned long mGeneration{0};
+    double mTicksPerSecond;
+    double mPageSize;
+    RateClock mClock{};
+
+    /// Read a file below /proc into mBuffer.
+    std::optional<std::string_view> readProcFile(const char *path);
+
+public:
+    /**
+     * @brief Constructor
+     * @param host The host name used to tag measurements.
+     * @param topN The number of processes reported by CPU and by memory.
+     */
+    ProcessCollector(std::string_view host, std::size_t topN);
+
+    ~ProcessCollector() override;
+
+    ProcessCollector(const ProcessCollector &) = delete;
+    ProcessCollector &operator=(const ProcessCollector &) = delete;
+
+    [[nodiscard]] bool valid() const { return mProcDir != nullptr; }
+
+    bool sample(MetricSink &sink) override;
+};
@@ -0,0 +1,136 @@
+/**
+ * @file Rollup.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <array>
+#include <vector>
+#include <string>
+#include <optional>
+#include <iostream>
+#include <algorithm>
+#include <limits>
+
+namespace aprs {
+
+    /**
+     * @class Rollup
+     * @brief Fixed period min, max, mean and count summaries of a set of values held in a ring buffer.
+     * @tparam Fields The number of values summarized.
+     * @details Buckets are aligned to multiples of the period in wall clock seconds. A bucket is closed
+     * when a value arrives for a later period, closed buckets are retained in the ring until
+     * overwritten and are marked pending until they have been written out.
+     */
+    template<std::size_t Fields>
+    class Rollup {
+    public:
+        using Values = std::array<std::optional<double>, Fields>;
+
+        struct Statistic {
+            double min{std::numeric_limits<double>::max()};
+            double max{std::numeric_limits<double>::lowest()};
+            double sum{0.};
+            unsigned long count{0};
+        };
+
+        struct Bucket {
+            long start{0};                          ///< Bucket start time, seconds since the epoch.
+            std::array<Statistic, Fields> stat{};
+        };
+
+    protected:
+        std::string mMeasurement{};     ///< The measurement name the rollup is written to.
+        long mPeriod{60};               ///< Bucket length in seconds.
+        std::vector<Bucket> mRing{};    ///< Closed buckets, oldest overwritten first.
+        std::size_t mHead{0};           ///< Next ring slot to write.
+        std::size_t mSize{0};           ///< Number of closed buckets held.
+        std::size_t mPending{0};        ///< Closed buckets not yet written out.
+        Bucket mCurrent{};              ///< The bucket being filled.
+        bool mActive{false};            ///< True when mCurrent holds values.
+
+        void close() {
+            mRing[mHead] = mCurrent;
+            mHead = (mHead + 1) % mRing.size();
+            mSize = std::min(mSize + 1, mRing.size());
+            mPending = std::min(mPending + 1, mRing.size());
+            mActive = false;
+        }
+
+    public:
+        Rollup(std::string measurement, long period, std::size_t depth)
+                : mMeasurement{std::move(measurement)}, mPeriod{period}, mRing(std::max(depth, std::size_t{1})) {}
+
+        /**
+         * @brief Add a set of values observed at a time.
+         * @param now Observation time, seconds since the epoch.
+         * @param values The values, fields without a value are skipped.
+         */
+        void add(long now, const Values &values) {
+            auto start = now - now % mPeriod;
+            if (mActive && start != mCurrent.start)
+                close();
+
+            if (!mActive) {
+                mCurrent = Bucket{};
+                mCurrent.start = start;
+                mActive = true;
+            }
+
+            for (std::size_t idx = 0; idx < Fields; ++idx) {
+                if (values[idx].has_value()) {
+                    auto &stat = mCurrent.stat[idx];
+                    auto value = values[idx].value();
+                    stat.min = std::min(stat.min, value);
+                    stat.max = std::max(stat.max, value);
+                    stat.sum += value;
+                    ++stat.count;
+                }
+            }
+        }
+
+        /// Number of closed buckets held in the ring.
+        [[nodiscard]] std::size_t size() const { return mSize; }
+
+        /// Access closed buckets, zero is the oldest.
+        [[nodiscard]] const Bucket &operator[](std::size_t idx) const {
+            return mRing[(mHead + mRing.size() - mSize + idx) % mRing.size()];
+        }
+
+        /**
+         * @brief Write pending buckets in influx line protocol with second precision time stamps.
+         * @param strm The output stream.
+         * @param tags The tag set, including the leading comma.
+         * @param fieldName A callable returning the field name for a field index.
+         */
+        template<typename FieldName>
+        std::ostream &printPending(std::ostream &strm, const std::string &tags, FieldName fieldName) const {
+            for (auto idx = mSize - mPending; idx < mSize; ++idx) {
+                auto &bucket = (*this)[idx];
+                char separator = ' ';
+                for (std::size_t field = 0; field < Fields; ++field) {
+                    auto &stat = bucket.stat[field];
+                    if (stat.count > 0) {
+                        if (separator == ' ')
+                            strm << mMeasurement << tags;
+                        auto name = fieldName(field);
+                        strm << separator << name << "_min=" << stat.min
+                             << ',' << name << "_max=" << stat.max
+                             << ',' << name << "_mean=" << stat.sum / static_cast<double>(stat.count)
+                             << ',' << name << "_count=" << stat.count;
+                        separator = ',';
+                    }
+                }
+                if (separator != ' ')
+                    strm << ' ' << bucket.start << '\n';
+            }
+            return strm;
+        }
+
+        /// Mark all pending buckets as written.
+        void clearPending() { mPending = 0; }
+    };
+}
@@ -0,0 +1,111 @@
+/**
+ * @file Scheduler.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-13
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <cerrno>
+#include <ctime>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+/**
+ * @class PeriodicTimer
+ * @brief A drift free periodic timer using absolute CLOCK_MONOTONIC deadlines.
+ * @details The timerfd is armed once with an absolute first deadline and a fixed interval, so the kernel
+ * computes every deadline from the start time and the time spent working between ticks never shifts the
+ * next one. The first deadline is chosen so ticks fall on wall clock multiples of the alignment, e.g. at
+ * :00 and :30 for a 30 second alignment, and each tick carries its nominal wall clock time.
+ */
+class PeriodicTimer {
+public:
+    using Nanoseconds = std::chrono::nanoseconds;
+
+    struct Tick {
+        std::uint64_t index;        ///< Tick number from 0, ticks missed by an overrun are skipped.
+        std::int64_t wallTime;      ///< Nominal wall clock time of the tick, nanoseconds since the epoch.
+        std::uint64_t missed;       ///< Ticks missed since the previous wait.
+    };
+
+protected:
+    int mFd{-1};
+    Nanoseconds mPeriod;
+    std::int64_t mStartWall{0};     ///< Wall clock time of tick 0.
+    std::uint64_t mIndex{0};        ///< Number of expirations seen.
+
+    static std::int64_t now(clockid_t clock) {
+        timespec ts{};
+        ::clock_gettime(clock, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+
+    static timespec toTimespec(std::int64_t ns) {
+        return timespec{static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000)};
+    }
+
+public:
+    /**
+     * @brief Constructor, arms the timer.
+     * @param period The tick period.
+     * @param alignment Tick 0 falls on a wall clock multiple of this, defaults to the period.
+     */
+    explicit PeriodicTimer(Nanoseconds period, std::optional<Nanoseconds> alignment = std::nullopt)
+            : mPeriod{period} {
+        mFd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+        if (mFd < 0)
+            return;
+
+        auto align = alignment.value_or(period).count();
+        auto wall = now(CLOCK_REALTIME);
+        auto monotonic = now(CLOCK_MONOTONIC);
+        auto offset = align - wall % align;
+        mStartWall = wall + offset;
+
+        itimerspec spec{};
+        spec.it_value = toTimespec(monotonic + offset);
+        spec.it_interval = toTimespec(period.count());
+        if (::timerfd_settime(mFd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+            ::close(mFd);
+            mFd = -1;
+        }
+    }
+
+    ~PeriodicTimer() {
+        if (mFd >= 0)
+            ::close(mFd);
+    }
+
+    PeriodicTimer(const PeriodicTimer &) = delete;
+    PeriodicTimer &operator=(const PeriodicTimer &) = delete;
+
+    [[nodiscard]] bool valid() const { return mFd >= 0; }
+
+    /// The timer descriptor, readable when a deadline has passed, for use with poll(2).
+    [[nodiscard]] int fd() const { return mFd; }
+
+    /// The current wall clock time in nanoseconds since the epoch.
+    static std::int64_t wallTime() { return now(CLOCK_REALTIME); }
+
+    [[nodiscard]] Nanoseconds period() const { return mPeriod; }
+
+    /**
+     * @brief Block until the next deadline.
+     * @return The tick, or std::nullopt if the timer failed or the wait was interrupted by a signal.
+     */
+    std::optional<Tick> wait() {
+        std::uint64_t expirations{};
+        auto n = ::read(mFd, &expirations, sizeof(expirations));
+        if (n != static_cast<ssize_t>(sizeof(expirations)) || expirations == 0)
+            return std::nullopt;
+
+        mIndex += expirations;
+        auto index = mIndex - 1;
+        return Tick{index, mStartWall + static_cast<std::int64_t>(index) * mPeriod.count(), expirations - 1};
+    }
+};
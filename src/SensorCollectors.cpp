@@ -0,0 +1,119 @@
+/**
+ * @file SensorCollectors.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-16
+ */
+
+#include <algorithm>
+#include <fstream>
+#include "SensorCollectors.h"
+#include "SystemCollectors.h"
+
+std::string SysfsCollector::readLine(const std::filesystem::path &path) {
+    std::string line{};
+    std::ifstream strm{path};
+    if (strm)
+        std::getline(strm, line);
+    return line;
+}
+
+std::vector<std::filesystem::path>
+SysfsCollector::entries(const std::filesystem::path &directory, std::string_view prefix) {
+    std::vector<std::filesystem::path> result{};
+    std::error_code ec{};
+    for (auto &entry : std::filesystem::directory_iterator{directory, ec}) {
+        if (entry.path().filename().string().rfind(prefix, 0) == 0)
+            result.push_back(entry.path());
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+bool SysfsCollector::sample(MetricSink &sink) {
+    if (mDiscover)
+        available();
+
+    bool ok = true;
+    for (auto &sensor : mSensors) {
+        if (auto content = sensor.mFile.read(); content.has_value()) {
+            long value{};
+            if (std::from_chars(content->data(), content->data() + content->size(), value).ec == std::errc()) {
+                sensor.mGauge.update(sink, sensor.mSeries, sensor.mField, static_cast<double>(value) * sensor.mScale);
+                continue;
+            }
+        }
+        ok = false;
+    }
+
+    // Devices have gone or been renumbered, find them again for the next sample.
+    if (!ok)
+        mDiscover = true;
+    return ok;
+}
+
+void ThermalCollector::discover() {
+    for (auto &zone : entries(mRoot / "class/thermal", "thermal_zone")) {
+        if (!std::filesystem::exists(zone / "temp"))
+            continue;
+        auto series = "thermal,host=" + mHost + ",zone=" + zone.filename().string() + ",type=" +
+                      escapeTag(readLine(zone / "type"));
+        mSensors.emplace_back(zone / "temp", std::move(series), "temp", 1.e-3);
+    }
+}
+
+void HwmonCollector::discover() {
+    struct Kind {
+        std::string_view prefix;
+        std::string_view field;
+        double scale;
+    };
+
+    // Millidegrees Celsius, revolutions per minute and millivolts.
+    static constexpr std::array<Kind, 3> Kinds{{{"temp", "temp", 1.e-3}, {"fan", "fan", 1.}, {"in", "voltage", 1.e-3}}};
+    static constexpr std::string_view InputSuffix{"_input"};
+
+    for (auto &chip : entries(mRoot / "class/hwmon", "hwmon")) {
+        auto chipName = readLine(chip / "name");
+        if (chipName.empty())
+            chipName = chip.filename().string();
+
+        for (auto &kind : Kinds) {
+            for (auto &input : entries(chip, kind.prefix)) {
+                auto name = input.filename().string();
+                if (name.size() <= InputSuffix.size() ||
+                    name.compare(name.size() - InputSuffix.size(), InputSuffix.size(), InputSuffix) != 0)
+                    continue;
+
+                // tempN_input is labelled by tempN_label when the driver provides one.
+                auto sensor = name.substr(0, name.size() - InputSuffix.size());
+                auto label = readLine(chip / (sensor + "_label"));
+                auto series = "hwmon,host=" + mHost + ",chip=" + escapeTag(chipName) + ",sensor=" +
+                              escapeTag(label.empty() ? sensor : label);
+                mSensors.emplace_back(input, std::move(series), kind.field, kind.scale);
+            }
+        }
+    }
+}
+
+void CpuFreqCollector::discover() {
+    struct Attribute {
+        std::string_view file;
+        std::string_view field;
+    };
+
+    static constexpr std::array<Attribute, 4> Attributes{{
+            {"scaling_cur_freq", "cur"},
+            {"scaling_max_freq", "scalingMax"},
+            {"cpuinfo_min_freq", "min"},
+            {"cpuinfo_max_freq", "max"}}};
+
+    for (auto &policy : entries(mRoot / "devices/system/cpu/cpufreq", "policy")) {
+        auto series = "cpufreq,host=" + mHost + ",policy=" + policy.filename().string();
+        for (auto &attribute : Attributes) {
+            // Frequencies are in kHz.
+            if (std::filesystem::exists(policy / attribute.file))
+                mSensors.emplace_back(policy / attribute.file, series, attribute.field, 1.e-3);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/**
+ * @file SensorCollectors.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-16
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+#include "Collector.h"
+#include "ProcFile.h"
+
+/**
+ * @class SysfsCollector
+ * @brief Collect single value sysfs attributes discovered at startup.
+ * @details Derived classes find their attribute files in discover(). Each sample reads the files held
+ * open, scales the integer value and sends it if it changed. A read that fails, even after the file is
+ * reopened, means devices have been renumbered or removed, so discovery is run again before the next
+ * sample rather than on every sample.
+ */
+class SysfsCollector : public Collector {
+protected:
+    struct Sensor {
+        ProcFile mFile;
+        std::string mSeries{};
+        std::string_view mField{};
+        double mScale{1.};
+        Gauge mGauge{};
+
+        Sensor(const std::filesystem::path &path, std::string series, std::string_view field, double scale)
+                : mFile{path.string(), 64}, mSeries{std::move(series)}, mField{field}, mScale{scale} {}
+    };
+
+    std::filesystem::path mRoot;        ///< The sysfs mount point.
+    std::string mHost{};
+    std::vector<Sensor> mSensors{};
+    bool mDiscover{true};
+
+    /// Find the attribute files, adding them to mSensors.
+    virtual void discover() = 0;
+
+    /// Read the first line of a small descriptive file such as a type or name, used during discovery.
+    static std::string readLine(const std::filesystem::path &path);
+
+    /// Sorted subdirectories of a directory whose names start with a prefix.
+    static std::vector<std::filesystem::path> entries(const std::filesystem::path &directory, std::string_view prefix);
+
+public:
+    SysfsCollector(std::string_view host, std::filesystem::path root) : mRoot{std::move(root)}, mHost{host} {}
+
+    bool sample(MetricSink &sink) override;
+
+    /// Run discovery now, returns true if anything was found.
+    bool available() {
+        mSensors.clear();
+        discover();
+        mDiscover = false;
+        return !mSensors.empty();
+    }
+};
+
+/**
+ * @class ThermalCollector
+ * @brief The temperature of every thermal zone, in degrees Celsius, tagged with the zone type.
+ */
+class ThermalCollector : public SysfsCollector {
+protected:
+    void discover() override;
+
+public:
+    explicit ThermalCollector(std::string_view host, std::filesystem::path root = "/sys")
+            : SysfsCollector(host, std::move(root)) {}
+};
+
+/**
+ * @class HwmonCollector
+ * @brief Temperature, fan and voltage inputs of every hwmon chip, tagged with chip name and sensor label.
+ */
+class HwmonCollector : public SysfsCollector {
+protected:
+    void discover() override;
+
+public:
+    explicit HwmonCollector(std::string_view host, std::filesystem::path root = "/sys")
+            : SysfsCollector(host, std::move(root)) {}
+};
+
+/**
+ * @class CpuFreqCollector
+ * @brief Current, minimum and maximum frequency of every cpufreq policy in MHz.
+ * @details The scaling limit is reported as well as the hardware limits, a scaling maximum below the
+ * hardware maximum, or a current frequency held below it under load, shows thermal throttling.
+ */
+class CpuFreqCollector : public SysfsCollector {
+protected:
+    void discover() override;
+
+public:
+    explicit CpuFreqCollector(std::string_view host, std::filesystem::path root = "/sys")
+            : SysfsCollector(host, std::move(root)) {}
+};
@@ -0,0 +1,96 @@
+/**
+ * @file StationExporter.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-22
+ */
+
+#include <cmath>
+#include <iostream>
+#include <sstream>
+#include "StationExporter.h"
+#include "WeatherAggregator.h"
+
+namespace aprs {
+
+    namespace {
+        InfluxPusher::Options pusherOptions(const StationExporter::Options &options) {
+            InfluxPusher::Options pusher{};
+            pusher.maxMemory = std::max(pusher.maxMemory, 4 * options.batchBytes);
+            pusher.maxBatch = std::max(pusher.maxBatch, options.batchBytes);
+            pusher.compress = true;
+            return pusher;
+        }
+    }
+
+    StationExporter::StationExporter(std::string url, Options options)
+            : mOptions{options}, mPusher{std::move(url), pusherOptions(options)} {}
+
+    StationExporter::~StationExporter() {
+        flush();
+        std::cerr << "Station export: " << mExported << " points, " << mThrottled << " reports throttled.\n";
+    }
+
+    void StationExporter::add(const PackedReport &report) {
+        auto now = Clock::now();
+        if (auto [entry, added] = mLastWrite.try_emplace(report.name(), now); !added) {
+            if (now - entry->second < mOptions.minInterval) {
+                ++mThrottled;
+                flushIfDue();
+                return;
+            }
+            entry->second = now;
+        }
+
+        // Callsigns are letters, digits and '-', escape anything else a tag can not hold.
+        std::ostringstream point{};
+        point << "station,call=";
+        for (auto c : report.name()) {
+            if (c == ' ' || c == ',' || c == '=' || c == '\\')
+                point << '\\';
+            point << c;
+        }
+        if (auto distance = report.distance(); distance.has_value())
+            point << ",distance=" << std::lround(distance.value());
+        if (auto bearing = report.bearing(); bearing.has_value())
+            point << ",bearing=" << std::lround(bearing.value()) % 360;
+
+        char separator = ' ';
+        for (auto &item : WeatherItemList) {
+            auto idx = static_cast<std::size_t>(item.wxSym);
+            auto value = report.value(idx);
+            if (item.wxFlag == 'l' || item.digits == 0 || !value.has_value())
+                continue;
+            point << separator << item.dbName << '=' << WeatherAggregator::metricValue(item, value.value());
+            separator = ',';
+        }
+        if (separator == ' ')
+            return;
+        if (report.rejectedMask() != 0)
+            point << ",rejected=" << report.rejectedMask() << 'i';
+
+        // Reports are timestamped when received.
+        auto received = std::chrono::system_clock::now() -
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(now - report.timePoint());
+        point << ' ' << std::chrono::duration_cast<std::chrono::seconds>(received.time_since_epoch()).count() << '\n';
+
+        if (mBatch.empty())
+            mBatchStart = now;
+        mBatch.append(point.str());
+        ++mExported;
+        flushIfDue();
+    }
+
+    void StationExporter::flushIfDue() {
+        if (!mBatch.empty() &&
+            (mBatch.size() >= mOptions.batchBytes || Clock::now() - mBatchStart >= mOptions.maxDelay))
+            flush();
+    }
+
+    void StationExporter::flush() {
+        if (mBatch.empty())
+            return;
+        mPusher.push(mBatch);
+        mBatch.clear();
+    }
+}
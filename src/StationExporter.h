@@ -0,0 +1,72 @@
+/**
+ * @file StationExporter.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-22
+ */
+
+#pragma once
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "PackedReport.h"
+#include "InfluxPusher.h"
+
+namespace aprs {
+
+    /**
+     * @class StationExporter
+     * @brief Export each station report as its own influx point, so the data behind the aggregate can be
+     * inspected.
+     * @details Points go to the "station" measurement tagged with the callsign and the distance (km) and
+     * bearing (degrees) from the QTH, with values in the same units as the aggregate and a bit mask of
+     * values rejected as outliers. A station is written at most once per minimum interval, later reports
+     * inside the interval are skipped. Points are collected into one batch which is handed to a gzip
+     * posting InfluxPusher when it reaches the batch size or the maximum delay, so the export adds one
+     * HTTP request per batch rather than one per report, and posting never blocks packet processing.
+     */
+    class StationExporter {
+    public:
+        using Clock = std::chrono::steady_clock;
+
+        struct Options {
+            std::chrono::seconds minInterval{300};      ///< Minimum time between points from one station.
+            std::size_t batchBytes{256 * 1024};         ///< Batch size which triggers a post.
+            std::chrono::seconds maxDelay{300};         ///< Longest a point waits for its batch to be posted.
+        };
+
+    protected:
+        Options mOptions;
+        InfluxPusher mPusher;
+        std::unordered_map<std::string_view, Clock::time_point> mLastWrite{};   ///< Keyed by interned name.
+        std::string mBatch{};
+        Clock::time_point mBatchStart{};
+        unsigned long mExported{0};
+        unsigned long mThrottled{0};
+
+    public:
+        /**
+         * @brief Constructor
+         * @param url The influx write URL, the database and precision=s.
+         * @param options Throttling and batching.
+         */
+        StationExporter(std::string url, Options options);
+
+        ~StationExporter();
+
+        StationExporter(const StationExporter &) = delete;
+        StationExporter &operator=(const StationExporter &) = delete;
+
+        /// Add a report to the batch unless the station was written within the minimum interval.
+        void add(const PackedReport &report);
+
+        /// Post the batch if it is due.
+        void flushIfDue();
+
+        /// Post the batch now.
+        void flush();
+    };
+}
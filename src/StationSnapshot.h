@@ -0,0 +1,47 @@
+/**
+ * @file StationSnapshot.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "APRS_Packet.h"
+
+namespace aprs {
+
+    /**
+     * @brief On disk layout of the station table snapshot.
+     * @details The file is a SnapshotHeader followed by SnapshotHeader::count SnapshotRecords in native
+     * byte order. A change to either structure requires a new SnapshotVersion.
+     */
+    static constexpr std::array<char, 8> SnapshotMagic{'A', 'P', 'R', 'S', 'W', 'X', 'S', 'N'};
+    static constexpr std::uint32_t SnapshotVersion = 1;
+
+    struct SnapshotHeader {
+        std::array<char, 8> magic;
+        std::uint32_t version;
+        std::uint32_t recordSize;       ///< sizeof(SnapshotRecord) when written.
+        std::uint64_t count;            ///< Number of records following the header.
+    };
+
+    struct SnapshotRecord {
+        std::array<char, 16> name;      ///< Null terminated station name.
+        std::int64_t received;          ///< Time the report was received, seconds since the epoch.
+        double lat;
+        double lon;
+        std::array<double, WeatherItemCount> value;
+        std::uint16_t valid;            ///< Bit per weather item set if value holds data.
+        std::uint16_t rejected;         ///< Bit per weather item set if the value was rejected.
+        char symTableId;
+        char symCode;
+    };
+
+    static_assert(std::is_trivially_copyable_v<SnapshotHeader> && std::is_trivially_copyable_v<SnapshotRecord>);
+    static_assert(WeatherItemCount <= 16, "Snapshot bit masks hold 16 items.");
+}
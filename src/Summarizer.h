@@ -0,0 +1,149 @@
+/**
+ * @file Summarizer.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-13
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Collector.h"
+
+/**
+ * @class Summarizer
+ * @brief Hold high frequency samples in memory and summarize them at each push.
+ * @details Each metric (series and field) keeps a ring of the samples taken since the last push. A summary
+ * sends the mean under the original field name, so existing queries keep working, plus field_min,
+ * field_max and field_p95. Values a collector skips as unchanged are still samples. A metric which is
+ * not sent at all, such as a process which has left the top N or exited, gets no samples, and once a whole
+ * interval passes without one it is dropped. A label is not summarized, the latest value sent in the
+ * interval is passed on under the field name. Storage is allocated when a metric is first seen, after
+ * that sampling and summarizing do not allocate.
+ */
+class Summarizer : public MetricSink {
+protected:
+    struct Metric {
+        std::string mSeries{};
+        std::string mField{};
+        std::string mMinField{}, mMaxField{}, mP95Field{};
+        std::vector<double> mRing{};    ///< Samples since the last summary.
+        std::size_t mCount{0};          ///< Samples held, at most mRing.size().
+        std::size_t mNext{0};           ///< Ring position of the next sample.
+        double mLast{0.};               ///< The last value of a label.
+        bool mLabel{false};             ///< True if the latest value is passed on rather than summarized.
+
+        void add(double value) {
+            mRing[mNext] = value;
+            mNext = (mNext + 1) % mRing.size();
+            mCount = std::min(mCount + 1, mRing.size());
+        }
+    };
+
+    std::vector<Metric> mMetrics{};
+    std::vector<double> mScratch{};     ///< Working copy for the percentile.
+    std::size_t mCapacity;              ///< Ring size of each metric.
+    std::size_t mCursor{0};             ///< Collectors send metrics in the same order, try here first.
+
+    Metric &find(std::string_view series, std::string_view field) {
+        auto matches = [&](const Metric &metric) {
+            return metric.mField == field && metric.mSeries == series;
+        };
+
+        if (mCursor < mMetrics.size() && matches(mMetrics[mCursor]))
+            return mMetrics[mCursor++];
+
+        auto found = std::find_if(mMetrics.begin(), mMetrics.end(), matches);
+        if (found == mMetrics.end()) {
+            auto &metric = mMetrics.emplace_back();
+            metric.mSeries = series;
+            metric.mField = field;
+            metric.mMinField = std::string{field} + "_min";
+            metric.mMaxField = std::string{field} + "_max";
+            metric.mP95Field = std::string{field} + "_p95";
+            metric.mRing.resize(mCapacity);
+            mCursor = mMetrics.size();
+            return metric;
+        }
+        mCursor = static_cast<std::size_t>(found - mMetrics.begin()) + 1;
+        return *found;
+    }
+
+public:
+    /**
+     * @brief Constructor
+     * @param capacity The number of samples held per metric, samples per push plus some allowance for jitter.
+     */
+    explicit Summarizer(std::size_t capacity) : mScratch(std::max<std::size_t>(capacity, 1)),
+                                                mCapacity{std::max<std::size_t>(capacity, 1)} {}
+
+    void metric(std::string_view series, std::string_view field, double value) override {
+        find(series, field).add(value);
+    }
+
+    void label(std::string_view series, std::string_view field, double value) override {
+        auto &metric = find(series, field);
+        metric.mLabel = true;
+        metric.mLast = value;
+        metric.mCount = 1;
+    }
+
+    void unchanged(std::string_view series, std::string_view field, double value) override {
+        metric(series, field, value);
+    }
+
+    /// Complete a sample.
+    void endSample() {
+        mCursor = 0;
+    }
+
+    /**
+     * @brief Send the summary of the samples held to a sink and start a new summary interval.
+     * @details Metrics which got no sample in the interval are dropped.
+     */
+    void summarize(MetricSink &sink) {
+        mMetrics.erase(std::remove_if(mMetrics.begin(), mMetrics.end(), [](const Metric &metric) {
+            return metric.mCount == 0;
+        }), mMetrics.end());
+        mCursor = 0;
+
+        for (auto &metric : mMetrics) {
+
+            // Labels are only sent when set during the interval.
+            if (metric.mLabel) {
+                sink.label(metric.mSeries, metric.mField, metric.mLast);
+                metric.mCount = 0;
+                continue;
+            }
+
+            auto begin = mScratch.begin();
+            auto end = begin + static_cast<std::ptrdiff_t>(metric.mCount);
+            std::copy_n(metric.mRing.begin(), metric.mCount, begin);
+
+            // The ring is only partly filled from the start, or completely, so the first mCount entries are
+            // exactly the samples held.
+            double sum = 0.;
+            for (auto it = begin; it != end; ++it)
+                sum += *it;
+            auto [min, max] = std::minmax_element(begin, end);
+
+            // Nearest rank 95th percentile.
+            auto rank = static_cast<std::ptrdiff_t>(std::ceil(0.95 * static_cast<double>(metric.mCount))) - 1;
+            auto p95 = begin + std::max<std::ptrdiff_t>(rank, 0);
+            double minValue = *min, maxValue = *max;
+            std::nth_element(begin, p95, end);
+
+            sink.metric(metric.mSeries, metric.mField, sum / static_cast<double>(metric.mCount));
+            sink.metric(metric.mSeries, metric.mMinField, minValue);
+            sink.metric(metric.mSeries, metric.mMaxField, maxValue);
+            sink.metric(metric.mSeries, metric.mP95Field, *p95);
+
+            metric.mCount = 0;
+            metric.mNext = 0;
+        }
+    }
+};
@@ -0,0 +1,185 @@
+/**
+ * @file SystemCollectors.cpp
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#include <filesystem>
+#include <sys/statvfs.h>
+#include "SystemCollectors.h"
+
+std::string escapeTag(std::string_view value) {
+    std::string result{};
+    for (auto c : value) {
+        if (c == ' ' || c == ',' || c == '=')
+            result.push_back('\\');
+        result.push_back(c);
+    }
+    return result;
+}
+
+bool MemInfoCollector::sample(MetricSink &sink) {
+    static constexpr double KiB = 1024.;
+
+    auto content = mMemInfo.read();
+    if (!content.has_value())
+        return false;
+
+    std::array<std::optional<double>, ItemCount> value{};
+    auto view = content.value();
+    while (!view.empty()) {
+        auto line = nextLine(view);
+        auto key = line.substr(0, line.find(':'));
+        for (std::size_t idx = 0; idx < mKeys.size(); ++idx) {
+            if (key == mKeys[idx]) {
+                if (auto kb = nextNumber(line); kb.has_value())
+                    value[idx] = static_cast<double>(kb.value()) * KiB;
+                break;
+            }
+        }
+    }
+
+    if (value[Total].has_value() && value[Available].has_value())
+        value[Used] = value[Total].value() - value[Available].value();
+
+    for (std::size_t idx = 0; idx < ItemCount; ++idx) {
+        if (value[idx].has_value())
+            mGauge[idx].update(sink, mSeries, mFields[idx], value[idx].value());
+    }
+    return true;
+}
+
+bool DiskStatsCollector::sample(MetricSink &sink) {
+    static constexpr unsigned long long SectorSize = 512;
+
+    auto content = mDiskStats.read();
+    if (!content.has_value())
+        return false;
+
+    auto interval = mClock.lap();
+    auto view = content.value();
+    while (!view.empty()) {
+        auto line = nextLine(view);
+
+        // Fields: major minor name reads merged sectors ms writes merged sectors ms in-flight io-ms ...
+        nextNumber(line);
+        nextNumber(line);
+        auto start = line.find_first_not_of(' ');
+        if (start == std::string_view::npos)
+            continue;
+        line.remove_prefix(start);
+        auto name = line.substr(0, line.find(' '));
+        line.remove_prefix(name.size());
+
+        auto [disk, added] = findDevice(mDisks, name);
+        if (added) {
+            // Report whole disks only, partitions do not appear in /sys/block.
+            disk.mInclude = name.rfind("loop", 0) != 0 && name.rfind("ram", 0) != 0 &&
+                            std::filesystem::exists("/sys/block/" + disk.mName);
+            disk.mSeries = "disk,host=" + mHost + ",device=" + escapeTag(name);
+        }
+        if (!disk.mInclude)
+            continue;
+
+        std::array<unsigned long long, 10> field{};
+        for (auto &f : field)
+            f = nextNumber(line).value_or(0);
+
+        // Sector counts are kept in bytes so the rates are bytes per second.
+        disk.mCounter[Reads] = field[0];
+        disk.mCounter[SectorsRead] = field[2] * SectorSize;
+        disk.mCounter[Writes] = field[4];
+        disk.mCounter[SectorsWritten] = field[6] * SectorSize;
+        disk.mIoTicks = field[9];
+
+        if (disk.mValid && interval > 0. && disk.mIoTicks >= disk.mPreviousIoTicks)
+            disk.mBusy.update(sink, disk.mSeries, "busy",
+                              std::min(100., static_cast<double>(disk.mIoTicks - disk.mPreviousIoTicks) /
+                                             (interval * 10.)));
+        disk.mPreviousIoTicks = disk.mIoTicks;
+
+        disk.sendRates(sink, mFields, interval);
+    }
+    return true;
+}
+
+bool NetDevCollector::sample(MetricSink &sink) {
+    auto content = mNetDev.read();
+    if (!content.has_value())
+        return false;
+
+    auto interval = mClock.lap();
+    auto view = content.value();
+
+    // Skip the two header lines.
+    nextLine(view);
+    nextLine(view);
+    while (!view.empty()) {
+        auto line = nextLine(view);
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos)
+            continue;
+        auto name = line.substr(0, colon);
+        name.remove_prefix(std::min(name.find_first_not_of(' '), name.size()));
+        line.remove_prefix(colon + 1);
+
+        auto [interface, added] = findDevice(mInterfaces, name);
+        if (added) {
+            interface.mInclude = name != "lo";
+            interface.mSeries = "net,host=" + mHost + ",interface=" + escapeTag(name);
+        }
+        if (!interface.mInclude)
+            continue;
+
+        // rx: bytes packets errs drop fifo frame compressed multicast, tx: bytes packets errs drop ...
+        std::array<unsigned long long, 12> field{};
+        for (auto &f : field)
+            f = nextNumber(line).value_or(0);
+
+        interface.mCounter[RxBytes] = field[0];
+        interface.mCounter[RxPackets] = field[1];
+        interface.mCounter[RxErrors] = field[2];
+        interface.mCounter[RxDropped] = field[3];
+        interface.mCounter[TxBytes] = field[8];
+        interface.mCounter[TxPackets] = field[9];
+        interface.mCounter[TxErrors] = field[10];
+        interface.mCounter[TxDropped] = field[11];
+
+        interface.sendRates(sink, mFields, interval);
+    }
+    return true;
+}
+
+FsUsageCollector::FsUsageCollector(std::string_view host, const std::vector<std::string> &paths) {
+    std::vector<std::string> mounts = paths.empty() ? std::vector<std::string>{"/"} : paths;
+    for (auto &path : mounts) {
+        auto &fileSystem = mFileSystems.emplace_back();
+        fileSystem.mPath = path;
+        fileSystem.mSeries = "fs,host=" + std::string{host} + ",path=" + escapeTag(path);
+    }
+}
+
+bool FsUsageCollector::sample(MetricSink &sink) {
+    bool ok = true;
+    for (auto &fileSystem : mFileSystems) {
+        struct statvfs stat{};
+        if (::statvfs(fileSystem.mPath.c_str(), &stat) != 0) {
+            ok = false;
+            continue;
+        }
+
+        auto blockSize = static_cast<double>(stat.f_frsize);
+        auto size = static_cast<double>(stat.f_blocks) * blockSize;
+        auto used = static_cast<double>(stat.f_blocks - stat.f_bfree) * blockSize;
+        auto available = static_cast<double>(stat.f_bavail) * blockSize;
+
+        fileSystem.mGauge[Size].update(sink, fileSystem.mSeries, mFields[Size], size);
+        fileSystem.mGauge[Used].update(sink, fileSystem.mSeries, mFields[Used], used);
+        fileSystem.mGauge[Available].update(sink, fileSystem.mSeries, mFields[Available], available);
+        if (used + available > 0.)
+            fileSystem.mGauge[UsedPercent].update(sink, fileSystem.mSeries, mFields[UsedPercent],
+                                                  100. * used / (used + available));
+    }
+    return ok;
+}
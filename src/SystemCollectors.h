@@ -0,0 +1,194 @@
+/**
+ * @file SystemCollectors.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "Collector.h"
+#include "ProcFile.h"
+
+/**
+ * @class RateClock
+ * @brief Measure the interval between samples for rate computation.
+ */
+class RateClock {
+protected:
+    std::chrono::steady_clock::time_point mLast{};
+    bool mValid{false};
+
+public:
+    /// Start a new interval, returns the length of the previous one in seconds or 0 if there was none.
+    double lap() {
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> interval = now - mLast;
+        auto result = mValid ? interval.count() : 0.;
+        mLast = now;
+        mValid = true;
+        return result;
+    }
+};
+
+/**
+ * @class CounterSet
+ * @brief Monotonic counters of one device with their previous values and rate gauges.
+ * @tparam Count The number of counters.
+ */
+template<std::size_t Count>
+struct CounterSet {
+    std::string mName{};
+    std::string mSeries{};
+    std::array<unsigned long long, Count> mCounter{};
+    std::array<unsigned long long, Count> mPrevious{};
+    std::array<Gauge, Count> mGauge{};
+    bool mValid{false};     ///< True when mPrevious holds a sample.
+    bool mInclude{true};    ///< False for devices which are not reported.
+
+    /// Send the rate per second of each counter, skipping rates which have not changed.
+    void sendRates(MetricSink &sink, const std::array<std::string_view, Count> &fields, double interval,
+                   double scale = 1.) {
+        if (mValid && interval > 0.) {
+            for (std::size_t idx = 0; idx < Count; ++idx) {
+                // A counter that went backwards has been reset, skip it this interval.
+                if (mCounter[idx] >= mPrevious[idx])
+                    mGauge[idx].update(sink, mSeries, fields[idx],
+                                       scale * static_cast<double>(mCounter[idx] - mPrevious[idx]) / interval);
+            }
+        }
+        mPrevious = mCounter;
+        mValid = true;
+    }
+};
+
+/**
+ * @brief Find a named device in a list, adding it if it is new.
+ * @return The device and true if it was added.
+ */
+template<class Device>
+std::pair<Device &, bool> findDevice(std::vector<Device> &devices, std::string_view name) {
+    for (auto &device : devices) {
+        if (device.mName == name)
+            return {device, false};
+    }
+    devices.emplace_back();
+    devices.back().mName = name;
+    return {devices.back(), true};
+}
+
+/**
+ * @brief Escape a tag value for influx line protocol.
+ */
+std::string escapeTag(std::string_view value);
+
+/**
+ * @class MemInfoCollector
+ * @brief Memory and swap use from /proc/meminfo, in bytes.
+ */
+class MemInfoCollector : public Collector {
+protected:
+    enum Item {
+        Total, Free, Available, Buffers, Cached, SwapTotal, SwapFree, Used, ItemCount
+    };
+
+    static constexpr std::array<std::string_view, Used> mKeys{
+            "MemTotal", "MemFree", "MemAvailable", "Buffers", "Cached", "SwapTotal", "SwapFree"};
+    static constexpr std::array<std::string_view, ItemCount> mFields{
+            "total", "free", "available", "buffers", "cached", "swapTotal", "swapFree", "used"};
+
+    ProcFile mMemInfo{"/proc/meminfo"};
+    std::string mSeries{};
+    std::array<Gauge, ItemCount> mGauge{};
+
+public:
+    explicit MemInfoCollector(std::string_view host) : mSeries{"mem,host=" + std::string{host}} {}
+
+    bool sample(MetricSink &sink) override;
+};
+
+/**
+ * @class DiskStatsCollector
+ * @brief IOPS, throughput and utilisation of whole disks from /proc/diskstats.
+ */
+class DiskStatsCollector : public Collector {
+protected:
+    enum Item {
+        Reads, SectorsRead, Writes, SectorsWritten, ItemCount
+    };
+
+    static constexpr std::array<std::string_view, ItemCount> mFields{"readIops", "readBytes", "writeIops", "writeBytes"};
+
+    using Device = CounterSet<ItemCount>;
+
+    struct Disk : Device {
+        unsigned long long mIoTicks{}, mPreviousIoTicks{};  ///< Milliseconds spent doing I/O.
+        Gauge mBusy{};
+    };
+
+    ProcFile mDiskStats{"/proc/diskstats", 16384};
+    std::string mHost{};
+    std::vector<Disk> mDisks{};
+    RateClock mClock{};
+
+public:
+    explicit DiskStatsCollector(std::string_view host) : mHost{host} {}
+
+    bool sample(MetricSink &sink) override;
+};
+
+/**
+ * @class NetDevCollector
+ * @brief Per interface byte, packet, error and drop rates from /proc/net/dev.
+ */
+class NetDevCollector : public Collector {
+protected:
+    enum Item {
+        RxBytes, RxPackets, RxErrors, RxDropped, TxBytes, TxPackets, TxErrors, TxDropped, ItemCount
+    };
+
+    static constexpr std::array<std::string_view, ItemCount> mFields{
+            "rxBytes", "rxPackets", "rxErrors", "rxDropped", "txBytes", "txPackets", "txErrors", "txDropped"};
+
+    using Interface = CounterSet<ItemCount>;
+
+    ProcFile mNetDev{"/proc/net/dev", 16384};
+    std::string mHost{};
+    std::vector<Interface> mInterfaces{};
+    RateClock mClock{};
+
+public:
+    explicit NetDevCollector(std::string_view host) : mHost{host} {}
+
+    bool sample(MetricSink &sink) override;
+};
+
+/**
+ * @class FsUsageCollector
+ * @brief File system size and use of configured mount points from statvfs(3).
+ */
+class FsUsageCollector : public Collector {
+protected:
+    enum Item {
+        Size, Used, Available, UsedPercent, ItemCount
+    };
+
+    static constexpr std::array<std::string_view, ItemCount> mFields{"size", "used", "available", "usedPercent"};
+
+    struct FileSystem {
+        std::string mPath{};
+        std::string mSeries{};
+        std::array<Gauge, ItemCount> mGauge{};
+    };
+
+    std::vector<FileSystem> mFileSystems{};
+
+public:
+    FsUsageCollector(std::string_view host, const std::vector<std::string> &paths);
+
+    bool sample(MetricSink &sink) override;
+};
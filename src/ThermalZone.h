@@ -0,0 +1,47 @@
+/**
+ * @file ThermalZone.h
+ * @author Richard Buckley <richard.buckley@ieee.org>
+ * @version 1.0
+ * @date 2021-09-12
+ */
+
+#pragma once
+
+#include <charconv>
+#include "ProcFile.h"
+#include "Collector.h"
+
+/**
+ * @class ThermalZone
+ * @brief Read a /sys/class/thermal zone temperature through a persistent file descriptor.
+ */
+class ThermalZone : public Collector {
+protected:
+    ProcFile mTempFile;
+    std::string mSysSeries{};
+
+public:
+    /**
+     * @brief Constructor
+     * @param host The host name used to tag measurements.
+     * @param zone The thermal zone number.
+     */
+    ThermalZone(std::string_view host, long zone)
+            : mTempFile{"/sys/class/thermal/thermal_zone" + std::to_string(zone) + "/temp", 64},
+              mSysSeries{"sys,host=" + std::string{host}} {}
+
+    [[nodiscard]] const std::string &path() const { return mTempFile.path(); }
+
+    /// Send the zone temperature as the cpuTemp field of the sys series.
+    bool sample(MetricSink &sink) override {
+        if (auto content = mTempFile.read(); content.has_value()) {
+            long temperature{};
+            auto [ptr, ec] = std::from_chars(content->data(), content->data() + content->size(), temperature);
+            if (ec == std::errc()) {
+                sink.metric(mSysSeries, "cpuTemp", static_cast<double>(temperature) / 1000.);
+                return true;
+            }
+        }
+        return false;
+    }
+};
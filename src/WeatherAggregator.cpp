@@ -5,7 +5,14 @@
  * @date 2021-08-30
  */
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <curlpp/cURLpp.hpp>
 #include <curlpp/Easy.hpp>
 #include <curlpp/Options.hpp>
@@ -16,30 +23,195 @@
 namespace aprs {
 
     void WeatherAggregator::clearAggregateData() {
-        for (auto &value : mValueAggregate)
-            value = std::nullopt;
-        for (auto &hann : mHannAggregate)
-            hann = std::nullopt;
+        for (auto &accumulator : mAccumulator)
+            accumulator = Accumulator{};
 
         auto now = std::chrono::steady_clock::now();
+        mEpoch = now;
 
         for (auto it = begin(); it != end();) {
-            std::chrono::duration<double> diff = now - it->second->mTimePoint;
+            std::chrono::duration<double> diff = now - it->second.timePoint();
             // Delete any weather reports more than 90 minutes old.
-            if (diff.count() > 5400.)
+            if (diff.count() > ReportLifetime)
                 it = erase(it);
             else
                 ++it;
         }
     }
 
-    std::ostream &WeatherAggregator::printInfluxFormat(ostream &strm, const std::string &prefix) const {
+    double WeatherAggregator::reportWeight(const PackedReport &report) const {
+        auto hann = report.hannValue();
+        if (mDecayRate > 0.) {
+            std::chrono::duration<double> age = report.timePoint() - mEpoch;
+            hann *= exp(mDecayRate * age.count());
+        }
+        return hann;
+    }
+
+    void WeatherAggregator::accumulate(const PackedReport &report, double sign) {
+        auto weight = reportWeight(report) * sign;
+        for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+            if (auto value = report.value(idx); value.has_value() && !report.rejected(idx)) {
+                auto &accumulator = mAccumulator[idx];
+                if (sign > 0.) {
+                    ++accumulator.count;
+                } else if (accumulator.count > 0) {
+                    --accumulator.count;
+                }
+
+                if (accumulator.count == 0) {
+                    // Drop any rounding residue when the last contributor leaves.
+                    accumulator = Accumulator{};
+                } else {
+                    accumulator.value += value.value() * weight;
+                    accumulator.weight += weight;
+                }
+            }
+        }
+    }
+
+    void WeatherAggregator::distribute(const PackedReport &report, bool add) {
+        // Histograms are keyed by the integer as it was transmitted, as held in the report.
+        if (mOutlierThreshold > 0.) {
+            for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+                if (report.has(idx)) {
+                    if (add)
+                        mDistribution[idx].insert(report.key(idx));
+                    else
+                        mDistribution[idx].erase(report.key(idx));
+                }
+            }
+        }
+    }
+
+    void WeatherAggregator::screenReport(PackedReport &report) {
+        // Scale factor making the median absolute deviation consistent with a standard deviation.
+        static constexpr double MadScale = 1.4826;
+
+        report.clearRejected();
+        if (mOutlierThreshold <= 0.)
+            return;
+
+        for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+            auto value = report.value(idx);
+            auto &distribution = mDistribution[idx];
+            if (!value.has_value() || distribution.size() < OutlierMinimumReports)
+                continue;
+
+            auto &item = WeatherItemList[idx];
+            auto median = distribution.median().value();
+            auto mad = static_cast<double>(distribution.mad(median).value()) / item.factor;
+            auto center = static_cast<double>(median) / item.factor;
+            auto limit = mOutlierThreshold * std::max(MadScale * mad, item.spread);
+
+            if (std::abs(value.value() - center) > limit) {
+                report.setRejected(idx, true);
+                ++mRejectCount[idx];
+                mRejectsPending = true;
+                mStationRejectsPending.insert(report.name());
+                // Only the first reject of each station and item is logged, later ones are only counted.
+                if (++mStationRejects[report.name()][idx] == 1)
+                    cerr << "Reject " << report.name() << ' ' << item.dbName << ' ' << value.value()
+                         << " median " << center << " MAD " << mad << ", later rejects are counted only\n";
+            }
+        }
+    }
+
+    void WeatherAggregator::resetDistributions() {
+        for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+            mDistribution[idx] = OrderStatistic{};
+            if (mOutlierThreshold > 0.) {
+                // Size each histogram to hold every value the packet format can carry.
+                long high = 0;
+                for (auto &item : WeatherItemList) {
+                    if (static_cast<std::size_t>(item.wxSym) == idx && item.digits > 0)
+                        high = std::max(high, static_cast<long>(std::pow(10., item.digits)) - 1 +
+                                              (item.wxFlag == 'l' ? 1000 : 0));
+                }
+                if (high > 0)
+                    mDistribution[idx] = OrderStatistic{-(high / 10), high};
+            }
+        }
+    }
+
+    void WeatherAggregator::rescale(TimePoint now) {
+        // Stored weights grow as exp(rate * (t - mEpoch)), move the epoch forward before they overflow.
+        static constexpr double RescaleLimit = 64.;
+
+        if (mDecayRate > 0.) {
+            std::chrono::duration<double> shift = now - mEpoch;
+            if (mDecayRate * shift.count() > RescaleLimit) {
+                auto factor = exp(-mDecayRate * shift.count());
+                for (auto &accumulator : mAccumulator) {
+                    accumulator.value *= factor;
+                    accumulator.weight *= factor;
+                }
+                mEpoch = now;
+            }
+        }
+    }
+
+    void WeatherAggregator::expireReports(TimePoint now) {
+        // A scan of the packed table once a minute costs less than queueing every arrival.
+        if (now - mLastExpiry < ExpiryInterval)
+            return;
+        mLastExpiry = now;
+
+        for (auto it = begin(); it != end();) {
+            std::chrono::duration<double> diff = now - it->second.timePoint();
+            if (diff.count() > ReportLifetime) {
+                accumulate(it->second, -1.);
+                distribute(it->second, false);
+                mStationRejects.erase(it->first);
+                it = erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void WeatherAggregator::setDecayHalfLife(double halfLife) {
+        mDecayRate = halfLife > 0. ? M_LN2 / halfLife : 0.;
+        aggregateData();
+    }
+
+    void WeatherAggregator::setOutlierThreshold(double threshold) {
+        mOutlierThreshold = std::max(threshold, 0.);
+        aggregateData();
+    }
+
+    void WeatherAggregator::addReport(const APRS_WX_Report &report) {
+        auto now = std::chrono::steady_clock::now();
+        rescale(now);
+        expireReports(now);
+
+        // A station's entry is created once and overwritten by each later report.
+        auto &name = mNames.intern(report.mName);
+        auto [entry, added] = try_emplace(name);
+        if (!added) {
+            accumulate(entry->second, -1.);
+            distribute(entry->second, false);
+        }
+        entry->second = PackedReport{report, name};
+
+        // Screen against the other stations before the new value joins the distribution.
+        screenReport(entry->second);
+        distribute(entry->second, true);
+        accumulate(entry->second, 1.);
+
+        updateRollups();
+    }
+
+    void WeatherAggregator::aggregateValues(AggregateValues &values) const {
         std::optional<double> temperature{}, relHumidity{}, windGust{};
+        for (auto &value : values)
+            value = std::nullopt;
+
         for (auto &item : WeatherItemList) {
             if (item.wxFlag != 'l') {
                 auto idx = static_cast<std::size_t>(item.wxSym);
-                if (mValueAggregate[idx].has_value()) {
-                    auto value = mValueAggregate[idx].value() / mHannAggregate[idx].value();
+                if (auto &accumulator = mAccumulator[idx]; accumulator.count > 0 && accumulator.weight > 0.) {
+                    auto value = accumulator.value / accumulator.weight;
                     switch (item.units) {
                         case Units::inch_100:
                             if (value < 0.01)
@@ -50,12 +222,7 @@ namespace aprs {
                     }
 
                     // Apply conversion for temperature, length and speed.
-                    if (item.units == Units::Fahrenheit)
-                        value = FahrenheitToCelsius(value);
-                    else if (item.units == Units::inch_100)
-                        value = value * 25.4;
-                    else if (item.units == Units::MPH)
-                        value = value * 1.60934;
+                    value = metricValue(item, value);
 
                     // Gather values needed for humidex and wind chill.
                     if (item.wxSym == WxSym::Temperature)
@@ -65,8 +232,7 @@ namespace aprs {
                     else if (item.wxSym == WxSym::WindGust)
                         windGust = value;
 
-                    // Add value to influx push.
-                    strm << prefix << item.dbName << '=' << value << '\n';
+                    values[idx] = value;
                 }
             }
         }
@@ -80,8 +246,8 @@ namespace aprs {
             auto h = 0.5555 * (e - 10.0);
             auto humidex = celsius + h;
 
-            strm << prefix << "DewPt=" << dewPoint << '\n';
-            strm << prefix << "Humidex=" << humidex << '\n';
+            values[static_cast<std::size_t>(WxSym::DewPoint)] = dewPoint;
+            values[static_cast<std::size_t>(WxSym::Humidex)] = humidex;
         }
 
         if (temperature.has_value() && windGust.has_value()) {
@@ -90,46 +256,267 @@ namespace aprs {
 
             auto windChill = 13.12 + 0.6215 * celsius - 11.37 * pow(velocity,0.16) + 0.3965 * celsius * pow(velocity,0.16);
 
-            strm << prefix << "WindChill=" << windChill << '\n';
+            values[WindChillIndex] = windChill;
+        }
+    }
+
+    std::ostream &WeatherAggregator::printInfluxFormat(ostream &strm, const std::string &prefix) const {
+        AggregateValues values{};
+        aggregateValues(values);
+
+        // Add values to influx push.
+        for (std::size_t idx = 0; idx < AggregateFieldCount; ++idx) {
+            if (values[idx].has_value())
+                strm << prefix << fieldName(idx) << '=' << values[idx].value() << '\n';
         }
 
         return strm;
     }
 
+    void WeatherAggregator::updateRollups() {
+        AggregateValues values{};
+        aggregateValues(values);
+        auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        for (auto &rollup : mRollups)
+            rollup.add(static_cast<long>(now), values);
+    }
+
+    std::ostream &WeatherAggregator::printRejectCounts(ostream &strm, const std::string &measurement,
+                                                       const std::string &tags) const {
+        auto printCounts = [&strm](const RejectCounts &counts) {
+            char separator = ' ';
+            for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+                if (counts[idx] > 0) {
+                    strm << separator << WeatherItemList[idx].dbName << '=' << counts[idx];
+                    separator = ',';
+                }
+            }
+            strm << '\n';
+        };
+
+        // Counts are cumulative, only those which changed are written so a post stays small with many stations.
+        if (mRejectsPending) {
+            strm << measurement << tags;
+            printCounts(mRejectCount);
+        }
+
+        for (auto name : mStationRejectsPending) {
+            auto station = mStationRejects.find(name);
+            if (station == mStationRejects.end())
+                continue;
+            strm << measurement << tags << ",station=";
+            for (auto c : name) {
+                if (c == ' ' || c == ',' || c == '=' || c == '\\')
+                    strm << '\\';
+                strm << c;
+            }
+            printCounts(station->second);
+        }
+
+        return strm;
+    }
+
+    void WeatherAggregator::clearRejectsPending() {
+        mRejectsPending = false;
+        mStationRejectsPending.clear();
+    }
+
     void WeatherAggregator::aggregateData() {
         clearAggregateData();
+        resetDistributions();
 
         for (const auto &report : (*this)) {
-            auto hann = report.second->mHannValue.value();
-            for (auto &item : WeatherItemList) {
-                std::optional<double> value;
-                auto idx = static_cast<std::size_t>(item.wxSym);
-                value = report.second->mWeatherValue[idx];
-
-                if (value.has_value()) {
-                    if (mValueAggregate[idx].has_value()) {
-                        mValueAggregate[idx].value() += value.value() * hann;
-                        mHannAggregate[idx].value() += hann;
-                    } else {
-                        mValueAggregate[idx] = value.value() * hann;
-                        mHannAggregate[idx] = hann;
-                    }
+            distribute(report.second, true);
+            accumulate(report.second, 1.);
+        }
+
+        updateRollups();
+    }
+
+    void WeatherAggregator::setLocation(const APRS_Position &qth, double radius) {
+        for (auto it = begin(); it != end();) {
+            auto position = it->second.position();
+            auto weight = position.mHannValue;
+            auto local = position.mDistance.has_value() && position.mDistance.value() == 0.;
+            if (position.setBearingDistance(qth) && position.mDistance.value() <= radius) {
+                position.setHannValue(radius);
+                if (local && position.mDistance.value() == 0.)
+                    position.mHannValue = weight;
+                it->second.setPosition(position);
+                ++it;
+            } else {
+                mStationRejects.erase(it->first);
+                it = erase(it);
+            }
+        }
+        aggregateData();
+    }
+
+    /// Write a whole buffer to a file descriptor, retrying short writes.
+    static bool writeAll(int fd, const void *data, std::size_t length) {
+        auto ptr = static_cast<const char *>(data);
+        while (length > 0) {
+            auto n = ::write(fd, ptr, length);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            ptr += n;
+            length -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    std::vector<SnapshotRecord> WeatherAggregator::snapshot() const {
+        auto steadyNow = std::chrono::steady_clock::now();
+        auto systemNow = std::chrono::system_clock::now();
+
+        std::vector<SnapshotRecord> records{};
+        records.reserve(size());
+        for (auto &[name, report] : *this) {
+            if (name.length() >= std::tuple_size_v<decltype(SnapshotRecord::name)>)
+                continue;
+
+            SnapshotRecord record{};
+            std::memcpy(record.name.data(), name.data(), name.length());
+            auto received = systemNow - std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    steadyNow - report.timePoint());
+            record.received = std::chrono::duration_cast<std::chrono::seconds>(received.time_since_epoch()).count();
+            record.lat = report.lat();
+            record.lon = report.lon();
+            for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+                if (auto value = report.value(idx); value.has_value()) {
+                    record.value[idx] = value.value();
+                    record.valid = static_cast<std::uint16_t>(record.valid | (1u << idx));
                 }
             }
+            record.rejected = report.rejectedMask();
+            record.symTableId = report.mSymTableId;
+            record.symCode = report.mSymCode;
+            records.push_back(record);
+        }
+        return records;
+    }
+
+    bool WeatherAggregator::writeSnapshot(const std::filesystem::path &path, const std::vector<SnapshotRecord> &records) {
+        SnapshotHeader header{SnapshotMagic, SnapshotVersion, sizeof(SnapshotRecord), records.size()};
+
+        auto tempPath = path;
+        tempPath += ".tmp";
+        auto fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            cerr << "Could not create snapshot " << tempPath << ": " << std::strerror(errno) << '\n';
+            return false;
+        }
+
+        bool ok = writeAll(fd, &header, sizeof(header)) &&
+                  writeAll(fd, records.data(), records.size() * sizeof(SnapshotRecord));
+        ok = (::fsync(fd) == 0) && ok;
+        ok = (::close(fd) == 0) && ok;
+
+        std::error_code ec{};
+        if (ok)
+            std::filesystem::rename(tempPath, path, ec);
+
+        if (!ok || ec) {
+            cerr << "Could not write snapshot " << path << ": " << (ec ? ec.message() : std::strerror(errno)) << '\n';
+            std::filesystem::remove(tempPath, ec);
+            return false;
+        }
+
+        return true;
+    }
+
+    std::size_t WeatherAggregator::loadSnapshot(const std::filesystem::path &path, const APRS_Position &qth,
+                                                double radius) {
+        auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            if (errno != ENOENT)
+                cerr << "Could not open snapshot " << path << ": " << std::strerror(errno) << '\n';
+            return 0;
+        }
+
+        struct stat fileStat{};
+        void *mapped = MAP_FAILED;
+        std::size_t length = 0;
+        if (::fstat(fd, &fileStat) == 0 && fileStat.st_size >= static_cast<off_t>(sizeof(SnapshotHeader))) {
+            length = static_cast<std::size_t>(fileStat.st_size);
+            mapped = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+
+        if (mapped == MAP_FAILED) {
+            cerr << "Could not map snapshot " << path << '\n';
+            return 0;
+        }
+
+        SnapshotHeader header{};
+        std::memcpy(&header, mapped, sizeof(header));
+        if (header.magic != SnapshotMagic || header.version != SnapshotVersion ||
+            header.recordSize != sizeof(SnapshotRecord) ||
+            header.count > (length - sizeof(SnapshotHeader)) / sizeof(SnapshotRecord)) {
+            cerr << "Ignoring incompatible snapshot " << path << '\n';
+            ::munmap(mapped, length);
+            return 0;
+        }
+
+        auto steadyNow = std::chrono::steady_clock::now();
+        auto systemNow = std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        auto records = reinterpret_cast<const SnapshotRecord *>(static_cast<const char *>(mapped) + sizeof(header));
+
+        std::vector<PackedReport> reports{};
+        reports.reserve(header.count);
+        for (std::size_t n = 0; n < header.count; ++n) {
+            auto &record = records[n];
+            auto age = std::max(systemNow - record.received, std::int64_t{0});
+            if (static_cast<double>(age) > ReportLifetime)
+                continue;
+
+            APRS_WX_Report report{};
+            report.mName = std::string{record.name.data(), strnlen(record.name.data(), record.name.size())};
+            report.mTimePoint = steadyNow - std::chrono::seconds(age);
+            report.mSymTableId = record.symTableId;
+            report.mSymCode = record.symCode;
+            report.mLat = record.lat;
+            report.mLon = record.lon;
+            report.setBearingDistance(qth);
+            report.setHannValue(radius);
+            for (std::size_t idx = 0; idx < WeatherItemCount; ++idx) {
+                if (record.valid & (1u << idx))
+                    report.mWeatherValue[idx] = record.value[idx];
+                report.mRejected[idx] = (record.rejected & (1u << idx)) != 0;
+            }
+            reports.emplace_back(report, mNames.intern(report.mName));
+        }
+        ::munmap(mapped, length);
+
+        std::size_t restored = 0;
+        for (auto &report : reports) {
+            if (auto [entry, added] = try_emplace(report.name(), report);
+                    added || entry->second.timePoint() < report.timePoint()) {
+                entry->second = report;
+                ++restored;
+            }
         }
 
-        cout.unsetf(ios::fixed | ios::scientific);
-        cout << setprecision(6);
+        aggregateData();
+        return restored;
     }
 
     bool WeatherAggregator::pushToInflux(const string &host, bool tls, unsigned int port, const std::string &dataBase) {
         std::stringstream buildUrl{};
         std::stringstream postField{};
 
-        buildUrl << (tls? "https" : "http") << "://" << host << ':' << port << "/write?db=" << dataBase;
+        buildUrl << (tls? "https" : "http") << "://" << host << ':' << port << "/write?db=" << dataBase
+                 << "&precision=s";
 //        std::cerr << "CurlPP URL: " << buildUrl.str() << '\n';
 
         printInfluxFormat(postField, "aggregate,call=VE3YSH ");
+        printRejectCounts(postField, "rejects", ",call=VE3YSH");
+        for (auto &rollup : mRollups)
+            rollup.printPending(postField, ",call=VE3YSH", fieldName);
 //        std::cerr << postField.str() << '\n';
         auto postData = postField.str();
 
@@ -148,6 +535,9 @@ namespace aprs {
                 request.setOpt(new curlpp::options::PostFields(postData));
 
                 request.perform();
+                for (auto &rollup : mRollups)
+                    rollup.clearPending();
+                clearRejectsPending();
             } catch (curlpp::LogicError &e) {
                 std::cerr << e.what() << std::endl;
                 return false;
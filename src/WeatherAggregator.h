@@ -8,26 +8,112 @@
 #pragma once
 
 #include <map>
-#include <memory>
+#include <set>
+#include <filesystem>
+#include <string_view>
+#include <vector>
 #include <iostream>
 #include <iomanip>
 #include <ios>
 
 #include "APRS_Packet.h"
+#include "OrderStatistic.h"
+#include "PackedReport.h"
+#include "Rollup.h"
+#include "StationSnapshot.h"
 
 namespace aprs {
     using namespace std;
 
-    class WeatherAggregator : public std::map<std::string, std::unique_ptr<APRS_WX_Report>> {
+    /**
+     * @class WeatherAggregator
+     * @brief The latest report of each station, keyed by the interned station name, and the aggregate of them.
+     */
+    class WeatherAggregator : public std::map<std::string_view, PackedReport> {
+    public:
+        using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+        static constexpr double ReportLifetime = 5400.;     ///< Seconds a report contributes to the aggregate.
+        static constexpr std::chrono::seconds ExpiryInterval{60};   ///< Time between scans for expired reports.
+        static constexpr std::size_t OutlierMinimumReports = 5; ///< Reports needed before screening a value.
+
+        using RejectCounts = std::array<unsigned long, WeatherItemCount>;
+
+        /// Published values are indexed by WxSym with wind chill, which has no packet symbol, last.
+        static constexpr std::size_t WindChillIndex = static_cast<std::size_t>(WxSym::Humidex) + 1;
+        static constexpr std::size_t AggregateFieldCount = WindChillIndex + 1;
+
+        using AggregateValues = std::array<std::optional<double>, AggregateFieldCount>;
+
+        /// The database field name of a published value.
+        static constexpr std::string_view fieldName(std::size_t idx) {
+            return idx == WindChillIndex ? "WindChill" : WeatherItemList[idx].dbName;
+        }
+
     protected:
+        /**
+         * @brief Running weighted sums for one weather item.
+         * @details With age decay enabled the weights are stored relative to mEpoch, every weight
+         * carries the same factor exp(-rate * (now - mEpoch)) so the ratio value / weight is the
+         * decayed mean without touching the accumulators as time passes.
+         */
+        struct Accumulator {
+            double value{0.};           ///< Sum of value * weight.
+            double weight{0.};          ///< Sum of weight.
+            std::size_t count{0};       ///< Number of reports contributing.
+        };
+
+        std::array<Accumulator, WeatherItemCount> mAccumulator{};
 
-        std::array<std::optional<double>, WeatherItemCount> mValueAggregate{};
-        std::array<std::optional<double>, WeatherItemCount> mHannAggregate{};
+        double mDecayRate{0.};          ///< Age decay rate in 1/s, zero disables decay.
+        TimePoint mEpoch{std::chrono::steady_clock::now()};    ///< Time at which the decay factor is one.
+
+        StationNames mNames{};          ///< The one copy of each station name.
+        TimePoint mLastExpiry{};        ///< Time of the last scan for expired reports.
+
+        double mOutlierThreshold{0.};   ///< Robust z-score above which a value is rejected, zero disables.
+        std::array<OrderStatistic, WeatherItemCount> mDistribution{};  ///< Distribution of each item.
+        RejectCounts mRejectCount{};    ///< Rejected values per item.
+        std::map<std::string_view, RejectCounts> mStationRejects{};    ///< Rejected values per station and item.
+        bool mRejectsPending{false};    ///< Total reject counts changed since the last post.
+        std::set<std::string_view> mStationRejectsPending{};  ///< Stations whose counts changed since the last post.
+
+        /// Downsampled history of the published values: one day of minutes, ten days of 10 minutes,
+        /// and thirty days of hours.
+        std::array<Rollup<AggregateFieldCount>, 3> mRollups{{
+                                                                    {"aggregate_1m", 60, 1440},
+                                                                    {"aggregate_10m", 600, 1440},
+                                                                    {"aggregate_1h", 3600, 720}
+                                                            }};
 
         void clearAggregateData();
 
+        [[nodiscard]] double reportWeight(const PackedReport &report) const;
+
+        void accumulate(const PackedReport &report, double sign);
+
+        void distribute(const PackedReport &report, bool add);
+
+        void screenReport(PackedReport &report);
+
+        void resetDistributions();
+
+        void rescale(TimePoint now);
+
+        void expireReports(TimePoint now);
+
+        void aggregateValues(AggregateValues &values) const;
+
+        void updateRollups();
+
         std::ostream &printInfluxFormat(ostream &strm, const std::string &prefix) const;
 
+        /// Write the reject counts which changed since the last successful post.
+        std::ostream &printRejectCounts(ostream &strm, const std::string &measurement, const std::string &tags) const;
+
+        /// Forget the changed reject counts once they have been posted.
+        void clearRejectsPending();
+
     public:
         bool pushToInflux(const string &host, bool tls, unsigned int port, const std::string &dataBase);
 
@@ -35,7 +121,81 @@ namespace aprs {
             return (fahrenheit - 32.) * (5./9.);
         }
 
+        /// Convert a value in packet units to the units stored in the database, Celsius, mm and km/h.
+        static double metricValue(const WeatherItem &item, double value) {
+            if (item.units == Units::Fahrenheit)
+                return FahrenheitToCelsius(value);
+            else if (item.units == Units::inch_100)
+                return value * 25.4;
+            else if (item.units == Units::MPH)
+                return value * 1.60934;
+            return value;
+        }
+
+        /**
+         * @brief Set the age decay half life.
+         * @param halfLife The half life in seconds, zero or less disables age decay.
+         */
+        void setDecayHalfLife(double halfLife);
+
+        /**
+         * @brief Set the outlier rejection threshold.
+         * @details A value is rejected when it is further than threshold times the scaled median
+         * absolute deviation (or the item spread if larger) from the median of all reports.
+         * @param threshold The robust z-score threshold, zero or less disables rejection.
+         */
+        void setOutlierThreshold(double threshold);
+
+        /**
+         * @brief Add or replace a station report and update the aggregate incrementally.
+         * @details Reports older than ReportLifetime are dropped by a scan at most once per ExpiryInterval.
+         * @param report The new report, packed so a decoding slot can be reused at once.
+         */
+        void addReport(const APRS_WX_Report &report);
+
+        /// Recompute the aggregate from all held reports and add it to the rollups.
         void aggregateData();
+
+        /**
+         * @brief Move the aggregate to a new location or radius.
+         * @details Distance and weight of every held report are recomputed and reports outside the new
+         * radius are dropped, so the station table survives a configuration change. Reports at the QTH,
+         * from local sensors, keep their own weight.
+         * @param qth The new location.
+         * @param radius The new filter radius in km.
+         */
+        void setLocation(const APRS_Position &qth, double radius);
+
+        /**
+         * @brief Copy the station table into snapshot records.
+         * @details The copy is cheap, it can be taken under a lock and written by writeSnapshot() outside it.
+         */
+        [[nodiscard]] std::vector<SnapshotRecord> snapshot() const;
+
+        /**
+         * @brief Write snapshot records to a binary snapshot file.
+         * @details The snapshot is written to a temporary file which is synced and renamed over path so a
+         * reader never sees a partial file.
+         * @param path The snapshot file path.
+         * @param records The records taken by snapshot().
+         * @return true on success.
+         */
+        static bool writeSnapshot(const std::filesystem::path &path, const std::vector<SnapshotRecord> &records);
+
+        /// Write the station table to a binary snapshot file, see writeSnapshot().
+        bool saveSnapshot(const std::filesystem::path &path) const {
+            return writeSnapshot(path, snapshot());
+        }
+
+        /**
+         * @brief Restore the station table from a snapshot file written by saveSnapshot().
+         * @details Reports older than ReportLifetime are dropped, distance and weight are recomputed
+         * for the current location and radius.
+         * @param path The snapshot file path.
+         * @param qth The current location.
+         * @param radius The current filter radius in km.
+         * @return the number of reports restored.
+         */
+        std::size_t loadSnapshot(const std::filesystem::path &path, const APRS_Position &qth, double radius);
     };
 }
-
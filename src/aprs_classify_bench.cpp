@@ -0,0 +1,199 @@
+//
+// Created by richard on 2021-09-21.
+//
+
+/**
+ * @file aprs_classify_bench.cpp
+ * @brief Measure the cost of classifying APRS-IS lines before decoding, and of decoding weather.
+ * @details Classifies every line of a captured feed, one packet per line as received from the server,
+ * or a built in sample if no file is given, and reports the mean time per line, the count of each class
+ * and the number of heap allocations made while classifying. The weather lines are then decoded into
+ * pooled packet slots, and the mean time and allocations per decode are reported.
+ * Usage: APRS_CLASSIFY_BENCH [passes] [capture file]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+#include "PacketClassifier.h"
+#include "PacketPool.h"
+#include "APRS_IS.h"
+
+static std::atomic_ulong allocations{0};
+
+/*
+ * Every replaceable allocation function is replaced, so each form of new is paired with a delete which
+ * releases through the same allocator. The release is kept out of line, once inlined GCC sees free()
+ * called on the result of operator new and warns of a mismatch at -O3.
+ */
+static void *countedAlloc(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) noexcept {
+    ++allocations;
+    if (size == 0)
+        size = 1;
+    if (alignment <= alignof(std::max_align_t))
+        return std::malloc(size);
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+[[gnu::noinline]] static void countedFree(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void *operator new(std::size_t size) {
+    if (auto ptr = countedAlloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size) {
+    if (auto ptr = countedAlloc(size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (auto ptr = countedAlloc(size, static_cast<std::size_t>(alignment)))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    if (auto ptr = countedAlloc(size, static_cast<std::size_t>(alignment)))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept {
+    return countedAlloc(size);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    return countedAlloc(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, std::size_t) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr, std::size_t) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr, std::align_val_t) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept { countedFree(ptr); }
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(ptr); }
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept { countedFree(ptr); }
+
+int main(int argc, char **argv) {
+    using namespace aprs;
+
+    unsigned long passes = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100000;
+
+    std::vector<std::string> lines{};
+    if (argc > 2) {
+        std::ifstream capture{argv[2]};
+        if (!capture) {
+            std::cerr << "Could not read " << argv[2] << '\n';
+            return 1;
+        }
+        std::string line{};
+        while (std::getline(capture, line))
+            lines.push_back(line + '\n');
+    } else {
+        lines = {
+                "# aprsc 2.1.10-gd72a17c 21 Sep 2021 14:00:00 GMT T2TEXAS 205.209.228.99:14580\n",
+                "VE3YSH-13>APRS,TCPIP*,qAC,T2TEXAS:@211400z4452.12N/07530.45W_180/004g010t055r000p000P000h72b10132\n",
+                "CW1234>APRS,TCPXX*,qAX,CWOP-3:_09211400c180s004g010t055r000p000P000h72b10132\n",
+                "VA3ABC-9>T3PX4Q,WIDE1-1,WIDE2-1,qAR,VE3XYZ:`i5dl!Ok/`\"4(}_%\n",
+                "VE3DEF>APDR15,TCPIP*,qAC,T2CAEAST:=4451.00N/07531.00W$/A=000300 Mobile\n",
+                "VE3GHI>APRS,TCPIP*,qAC,T2CAEAST::VE3DEF   :Hello{01\n",
+                "VE3JKL>APRS,TCPIP*,qAC,T2CAEAST:T#001,123,045,067,000,000,00000000\n",
+                "VE3MNO>APRS,TCPIP*,qAC,T2CAEAST:;LEADER   *092345z4451.00N/07531.00W>088/036\n",
+                "VE3PQR>APRS,TCPIP*,qAC,T2CAEAST:!/5L!!<*e7>7P[\n",
+        };
+    }
+
+    PacketClassifier classifier{};
+    for (auto &line : lines)
+        classifier.classify(line);
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long pass = 0; pass < passes; ++pass) {
+        for (auto &line : lines)
+            classifier.classify(line);
+    }
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    auto allocated = allocations.load();
+
+    for (std::size_t idx = 0; idx < PacketClassCount; ++idx) {
+        auto packetClass = static_cast<PacketClass>(idx);
+        std::cout << PacketClassifier::className(packetClass) << ": "
+                  << classifier.count(packetClass) / (passes + 1) << '\n';
+    }
+    std::cout << "lines: " << lines.size() * passes
+              << " mean: " << elapsed.count() / static_cast<double>(lines.size() * passes) << " ns/line"
+              << " allocations: " << allocated << '\n';
+
+    // Decoding, the first pass fills the pool and the decoder's station tables.
+    APRS_IS decoder{"N0CALL", "-1", ""};
+    decoder.mQthPosition.mLat = 44.87;
+    decoder.mQthPosition.mLon = -75.51;
+    decoder.mRadius = 50.;
+    PacketPool pool{};
+    std::vector<std::string> weather{};
+    for (auto &line : lines)
+        if (classifier.classify(line).packetClass == PacketClass::Weather)
+            weather.push_back(line);
+
+    unsigned long decoded = 0;
+    auto decodeAll = [&]() {
+        for (auto &line : weather) {
+            decoder.mPacket.assign(line);
+            auto packet = pool.acquire();
+            if (decoder.decode(classifier.classify(decoder.mPacket), *packet) == PacketStatus::WxPacket)
+                ++decoded;
+        }
+    };
+    decodeAll();
+
+    allocations = 0;
+    start = std::chrono::steady_clock::now();
+    for (unsigned long pass = 0; pass < passes; ++pass)
+        decodeAll();
+    elapsed = std::chrono::steady_clock::now() - start;
+    auto decodeAllocated = allocations.load();
+
+    if (!weather.empty())
+        std::cout << "weather: " << weather.size() * passes
+                  << " mean: " << elapsed.count() / static_cast<double>(weather.size() * passes) << " ns/decode"
+                  << " reports: " << decoded / (passes + 1)
+                  << " allocations: " << decodeAllocated << " pool: " << pool.size() << '\n';
+
+    return allocated == 0 && decodeAllocated == 0 ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+//
+// Created by richard on 2021-09-25.
+//
+
+/**
+ * @file aprs_is_sim.cpp
+ * @brief A local APRS-IS server which streams weather packets at a set rate, to load test APRS_WX.
+ * @details Each client is sent the aprsc banner, its "user ... pass ... filter ..." login is answered with
+ * a logresp, verified if the passcode matches the callsign, then packets are streamed at the set rate with
+ * a server heartbeat every heartbeat interval. Filters sent after login are accepted and ignored.
+ *
+ * Packets are numbered from the start of the simulator and packet n is due at n / rate seconds, every
+ * client is sent the same packet at the same time, so a client holding several connections sees the
+ * duplicates a pool of real servers would send. Synthetic packets are positioned weather reports from
+ * the given number of stations spread over the radius around a location, each station reporting in turn.
+ * With a capture file, one packet per line as received from a server, the capture is replayed in a loop.
+ * A capture shorter than 30 seconds at the rate repeats packets inside the duplicate window of APRS_WX.
+ *
+ * Every report interval the packets sent to each client and its rate are printed, with the packets it is
+ * behind, which grows when the client does not read as fast as the rate. Point APRS_WX at the simulator
+ * with aprsServer and aprsPort and raise the rate until it falls behind to find the sustainable rate.
+ *
+ * Usage: APRS_IS_SIM [--port 14580] [--rate 100] [--stations 500] [--lat 44.87] [--lon -75.5]
+ * [--radius 50] [--heartbeat 20] [--report 10] [--capture file]
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include <poll.h>
+#include "InputParser.h"
+#include "basic_socket.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    std::atomic_bool run{true};
+
+    void signalHandler(int) {
+        run = false;
+    }
+
+    constexpr std::string_view ServerName = "SIM";
+    constexpr std::string_view Version = "# aprsc 2.1.10-sim";
+    constexpr std::chrono::seconds LoginTimeout{10};
+    constexpr std::size_t MaxWrite = 64 * 1024;     ///< Largest write, so input and heartbeats are not held up.
+
+    struct Options {
+        std::string port{"14580"};
+        double rate{100.};                          ///< Packets per second.
+        unsigned long stations{500};
+        double lat{44.87};
+        double lon{-75.5};
+        double radius{50.};                         ///< km
+        std::chrono::seconds heartbeat{20};
+        std::chrono::seconds report{10};
+    };
+
+    /// The APRS-IS passcode of a callsign, the SSID is not included.
+    long passCode(std::string_view callsign) {
+        auto base = callsign.substr(0, callsign.find('-'));
+        unsigned hash = 0x73e2;
+        for (std::size_t i = 0; i < base.size(); i += 2) {
+            hash ^= static_cast<unsigned>(std::toupper(base[i])) << 8u;
+            if (i + 1 < base.size())
+                hash ^= static_cast<unsigned>(std::toupper(base[i + 1]));
+        }
+        return static_cast<long>(hash & 0x7fffu);
+    }
+
+    /// Format a coordinate as degrees and hundredths of minutes, DDMM.mmN or DDDMM.mmE.
+    std::string coordinate(double degrees, int degreeDigits, char positive, char negative) {
+        auto hundredths = std::lround(std::abs(degrees) * 6000.);
+        char buffer[48];    // Room for any long, -Wformat-truncation checks against the full range.
+        std::snprintf(buffer, sizeof(buffer), "%0*ld%02ld.%02ld%c", degreeDigits, hundredths / 6000,
+                      (hundredths % 6000) / 100, hundredths % 100, degrees < 0. ? negative : positive);
+        return buffer;
+    }
+
+    /**
+     * @class PacketSource
+     * @brief Packet n of the simulated feed, the same for every client.
+     */
+    class PacketSource {
+    protected:
+        std::vector<std::string> mCapture{};
+        std::vector<std::string> mPositions{};      ///< Formatted position of each synthetic station.
+
+    public:
+        explicit PacketSource(const Options &options) {
+            // Stations spread uniformly over the disk, the same on every run.
+            std::mt19937 random{static_cast<std::mt19937::result_type>(options.stations)};
+            std::uniform_real_distribution<double> unit{0., 1.};
+            mPositions.reserve(options.stations);
+            for (unsigned long station = 0; station < options.stations; ++station) {
+                auto distance = options.radius * std::sqrt(unit(random));
+                auto bearing = 2. * M_PI * unit(random);
+                auto lat = options.lat + distance * std::cos(bearing) / 111.2;
+                auto lon = options.lon + distance * std::sin(bearing) / (111.2 * std::cos(options.lat * M_PI / 180.));
+                mPositions.push_back(coordinate(lat, 2, 'N', 'S') + '/' + coordinate(lon, 3, 'E', 'W'));
+            }
+        }
+
+        bool loadCapture(const std::string &path) {
+            std::ifstream capture{path};
+            std::string line{};
+            while (std::getline(capture, line)) {
+                while (!line.empty() && (line.back() == '\r' || line.back() == '\n'))
+                    line.pop_back();
+                if (!line.empty() && line.front() != '#')
+                    mCapture.push_back(line + "\r\n");
+            }
+            return !mCapture.empty();
+        }
+
+        /**
+         * @brief Append packet n to a buffer.
+         * @param buffer The buffer.
+         * @param n The packet number.
+         * @param due The time the packet is due, used as the report timestamp.
+         */
+        void append(std::string &buffer, unsigned long n, std::chrono::system_clock::time_point due) const {
+            if (!mCapture.empty()) {
+                buffer.append(mCapture[n % mCapture.size()]);
+                return;
+            }
+
+            auto station = n % mPositions.size();
+            auto round = n / mPositions.size();
+            std::mt19937 random{static_cast<std::mt19937::result_type>(n)};
+            std::normal_distribution<double> noise{0., 1.};
+
+            // Values drift slowly from round to round and differ a little between stations.
+            auto drift = std::sin(static_cast<double>(round) * 0.05);
+            auto temperature = std::lround(55. + 10. * drift + 2. * noise(random));
+            auto humidity = std::clamp(std::lround(70. - 15. * drift + 3. * noise(random)), 1L, 100L) % 100;
+            auto pressure = std::lround(10132. + 40. * drift + 5. * noise(random));
+            auto direction = std::lround(180. + 90. * drift + 20. * noise(random) + 360.) % 360;
+            auto speed = std::max(std::lround(8. + 4. * drift + 2. * noise(random)), 0L);
+            auto gust = speed + std::max(std::lround(4. + 2. * noise(random)), 0L);
+
+            auto time = std::chrono::system_clock::to_time_t(due);
+            std::tm utc{};
+            gmtime_r(&time, &utc);
+
+            char packet[160];
+            std::snprintf(packet, sizeof(packet),
+                          "SIM%lu>APRS,TCPIP*,qAC,%.*s:@%02d%02d%02dz%s_%03ld/%03ldg%03ldt%03ldr000p000P000h%02ldb%05ld\r\n",
+                          station, static_cast<int>(ServerName.size()), ServerName.data(), utc.tm_mday, utc.tm_hour,
+                          utc.tm_min, mPositions[station].c_str(), direction, speed, gust, temperature, humidity,
+                          pressure);
+            buffer.append(packet);
+        }
+    };
+
+    /// A connected client, statistics are read by the main thread.
+    struct Client {
+        std::unique_ptr<sockets::local_socket> socket;
+        std::string peer{};
+        std::string user{};                     ///< Written by the client thread before loggedIn is set.
+        std::atomic_bool loggedIn{false};
+        std::atomic_ulong sent{0};
+        std::atomic_ulong behind{0};
+        std::atomic_bool done{false};
+        unsigned long reported{0};              ///< Packets sent at the last report.
+        std::thread thread{};
+    };
+
+    bool sendAll(int fd, std::string_view data) {
+        while (!data.empty()) {
+            auto n = ::send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data.remove_prefix(static_cast<std::size_t>(n));
+        }
+        return true;
+    }
+
+    /// Read one line from a client, waiting at most until the deadline.
+    bool readLine(int fd, std::string &line, Clock::time_point deadline) {
+        line.clear();
+        char c;
+        while (run && Clock::now() < deadline) {
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, 100) <= 0)
+                continue;
+            if (::recv(fd, &c, 1, 0) <= 0)
+                return false;
+            if (c == '\n')
+                return true;
+            if (c != '\r')
+                line.push_back(c);
+        }
+        return false;
+    }
+
+    std::string heartbeatLine(const std::string &port) {
+        auto time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+        std::tm utc{};
+        gmtime_r(&time, &utc);
+        char date[32];
+        std::strftime(date, sizeof(date), "%d %b %Y %H:%M:%S GMT", &utc);
+        std::stringstream line{};
+        line << Version << ' ' << date << ' ' << ServerName << " 127.0.0.1:" << port << "\r\n";
+        return line.str();
+    }
+
+    /**
+     * @brief Log a client in and stream packets to it until it disconnects or the simulator stops.
+     * @param client The client.
+     * @param options The simulator options.
+     * @param source The packets.
+     * @param start The time packet 0 was due.
+     * @param systemStart The same time by the system clock.
+     */
+    void serve(Client &client, const Options &options, const PacketSource &source, Clock::time_point start,
+               std::chrono::system_clock::time_point systemStart) {
+        // Signals are handled by the main thread.
+        sigset_t signals;
+        sigfillset(&signals);
+        pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+        auto fd = client.socket->fd();
+        std::string line{};
+        if (!sendAll(fd, std::string{Version} + "\r\n") || !readLine(fd, line, Clock::now() + LoginTimeout) ||
+            line.rfind("user ", 0) != 0) {
+            std::cerr << "Login failed " << client.peer << '\n';
+            client.done = true;
+            return;
+        }
+
+        std::string user{}, pass{}, token{}, filter{};
+        std::istringstream login{line};
+        while (login >> token) {
+            if (token == "user")
+                login >> user;
+            else if (token == "pass")
+                login >> pass;
+            else if (token == "filter")
+                std::getline(login >> std::ws, filter);
+        }
+        bool verified = !pass.empty() && std::strtol(pass.c_str(), nullptr, 10) == passCode(user);
+        client.user = user;
+        client.loggedIn = true;
+        std::cerr << "Login " << user << (verified ? " verified" : " unverified") << " from " << client.peer
+                  << " filter " << filter << '\n';
+
+        std::stringstream response{};
+        response << "# logresp " << user << (verified ? " verified" : " unverified") << ", server " << ServerName
+                 << "\r\n";
+        if (!sendAll(fd, response.str())) {
+            client.done = true;
+            return;
+        }
+
+        auto dueIndex = [&](Clock::time_point now) {
+            return static_cast<unsigned long>(std::chrono::duration<double>(now - start).count() * options.rate);
+        };
+        auto dueTime = [&](unsigned long n) {
+            return std::chrono::duration<double>(static_cast<double>(n) / options.rate);
+        };
+
+        // Join the feed where the other clients are.
+        auto next = dueIndex(Clock::now());
+        auto heartbeat = Clock::now();
+        std::string buffer{};
+        std::array<char, 1024> input{};
+        while (run) {
+            auto now = Clock::now();
+            auto due = dueIndex(now);
+            buffer.clear();
+            unsigned long count = 0;
+            for (; next < due && buffer.size() < MaxWrite; ++next, ++count)
+                source.append(buffer, next, systemStart + std::chrono::duration_cast<std::chrono::system_clock::duration>(dueTime(next)));
+            if (now - heartbeat >= options.heartbeat) {
+                buffer.append(heartbeatLine(options.port));
+                heartbeat = now;
+            }
+            if (!buffer.empty() && !sendAll(fd, buffer))
+                break;
+            client.sent += count;
+            client.behind = due - next;
+
+            // Wait for the next packet, reading anything the client sends meanwhile.
+            auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    start + std::chrono::duration_cast<Clock::duration>(dueTime(next)) - Clock::now()).count();
+            pollfd pfd{fd, POLLIN, 0};
+            if (::poll(&pfd, 1, static_cast<int>(std::clamp<long>(wait, 0, 100))) > 0) {
+                auto n = ::recv(fd, input.data(), input.size(), 0);
+                if (n <= 0)
+                    break;
+                std::string_view text{input.data(), static_cast<std::size_t>(n)};
+                if (text.rfind("#filter", 0) == 0)
+                    std::cerr << user << ' ' << text.substr(0, text.find_first_of("\r\n")) << '\n';
+            }
+        }
+
+        std::cerr << "Disconnect " << user << ' ' << client.peer << " after " << client.sent << " packets\n";
+        client.done = true;
+    }
+}
+
+int main(int argc, char **argv) {
+    InputParser inputParser{argc, argv};
+
+    auto option = [&](std::string_view name, std::string_view defaultValue) {
+        return inputParser.cmdOptionExists(name) ? std::string{inputParser.getCmdOption(name)}
+                                                 : std::string{defaultValue};
+    };
+
+    try {
+        Options options{};
+        options.port = option("--port", options.port);
+        options.rate = std::stod(option("--rate", "100"));
+        options.stations = std::stoul(option("--stations", "500"));
+        options.lat = std::stod(option("--lat", "44.87"));
+        options.lon = std::stod(option("--lon", "-75.5"));
+        options.radius = std::stod(option("--radius", "50"));
+        options.heartbeat = std::chrono::seconds{std::stol(option("--heartbeat", "20"))};
+        options.report = std::chrono::seconds{std::stol(option("--report", "10"))};
+        if (options.rate <= 0. || options.stations == 0 || options.report.count() <= 0) {
+            std::cerr << "Rate, stations and report interval must be greater than zero.\n";
+            return 1;
+        }
+
+        PacketSource source{options};
+        if (inputParser.cmdOptionExists("--capture") && !source.loadCapture(inputParser.getCmdOption("--capture"))) {
+            std::cerr << "Could not read packets from " << inputParser.getCmdOption("--capture") << '\n';
+            return 1;
+        }
+
+        std::signal(SIGINT, signalHandler);
+        std::signal(SIGTERM, signalHandler);
+
+        sockets::local_socket listener{"", options.port};
+        if (listener.listen(8, AF_INET6, AF_INET, AF_UNSPEC) < 0) {
+            std::cerr << "Could not listen on port " << options.port << '\n';
+            return 1;
+        }
+        std::cerr << "Listening on port " << options.port << ", " << options.rate << " packets/s from "
+                  << (inputParser.cmdOptionExists("--capture") ? inputParser.getCmdOption("--capture")
+                                                              : std::to_string(options.stations) + " stations")
+                  << '\n';
+
+        auto start = Clock::now();
+        auto systemStart = std::chrono::system_clock::now();
+        auto reportTime = start;
+        std::list<Client> clients{};
+
+        while (run) {
+            pollfd pfd{listener.fd(), POLLIN, 0};
+            if (::poll(&pfd, 1, 200) > 0 && (pfd.revents & POLLIN)) {
+                sockaddr_storage address{};
+                socklen_t length = sizeof(address);
+                auto fd = ::accept4(listener.fd(), reinterpret_cast<sockaddr *>(&address), &length, SOCK_CLOEXEC);
+                if (fd >= 0) {
+                    auto &client = clients.emplace_back();
+                    client.socket = std::make_unique<sockets::local_socket>(fd, reinterpret_cast<sockaddr *>(&address),
+                                                                            length);
+                    client.peer = client.socket->getPeerName(NI_NUMERICHOST | NI_NUMERICSERV);
+                    client.thread = std::thread{serve, std::ref(client), std::cref(options), std::cref(source), start,
+                                                systemStart};
+                }
+            }
+
+            if (auto now = Clock::now(); now - reportTime >= options.report) {
+                std::chrono::duration<double> elapsed = now - reportTime;
+                reportTime = now;
+                for (auto &client : clients) {
+                    if (!client.loggedIn)
+                        continue;
+                    auto sent = client.sent.load();
+                    std::cerr << "Client " << client.user << ' ' << client.peer << " sent " << sent << " packets, "
+                              << std::lround(static_cast<double>(sent - client.reported) / elapsed.count())
+                              << " packets/s, behind " << client.behind << '\n';
+                    client.reported = sent;
+                }
+            }
+
+            for (auto client = clients.begin(); client != clients.end();) {
+                if (client->done) {
+                    client->thread.join();
+                    client = clients.erase(client);
+                } else {
+                    ++client;
+                }
+            }
+        }
+
+        // Wake clients blocked writing to a reader which has stopped.
+        for (auto &client : clients)
+            ::shutdown(client.socket->fd(), SHUT_RDWR);
+        for (auto &client : clients)
+            client.thread.join();
+    } catch (std::exception &e) {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -3,23 +3,32 @@
 //
 
 #include <iostream>
+#include <sstream>
 #include <iomanip>
 #include <optional>
 #include <vector>
 #include <cmath>
 #include <csignal>
 #include <cstring>
+#include <future>
+#include <mutex>
 #include "InputParser.h"
 #include "XDGFilePaths.h"
 #include "ConfigFile.h"
 #include "APRS_Packet.h"
 #include "APRS_IS.h"
 #include "WeatherAggregator.h"
+#include "LocalSensors.h"
+#include "FilterPlanner.h"
+#include "FeedMerger.h"
+#include "PacketPool.h"
+#include "StationExporter.h"
 
 using namespace std;
 using namespace sockets;
 
 static std::atomic_bool run{true};
+static std::atomic_bool reload{false};
 
 [[maybe_unused]] void usage(const std::string &app) {
     cout << "Usage: " << app
@@ -39,9 +48,11 @@ void signalHandler(int signum) {
     run = false;
 }
 
-int main(int argc, char **argv) {
-    static constexpr std::string_view ConfigOption = "--config";
+void hangupHandler(int) {
+    reload = true;
+}
 
+namespace {
     enum class ConfigItem {
         Callsign,
         Passcode,
@@ -54,9 +65,29 @@ int main(int argc, char **argv) {
         InfluxDb,
         InfluxRepeats,
         ServerCycleRate,
+        ServerConnections,
+        ServerName,
+        ServerPort,
+        DecayHalfLife,
+        OutlierThreshold,
+        SnapshotFile,
+        SnapshotInterval,
+        LocalName,
+        LocalWeight,
+        LocalInterval,
+        LocalPort,
+        LocalTag,
+        DhtChip,
+        DhtLine,
+        DhtType,
+        FilterBudlist,
+        FilterDiscovery,
+        ExportStations,
+        ExportInterval,
+        ExportBatch,
     };
 
-    std::vector<ConfigFile::Spec> ConfigSpec
+    const std::vector<ConfigFile::Spec> ConfigSpec
             {{
                      {"callsign", ConfigItem::Callsign},
                      {"passcode", ConfigItem::Passcode},
@@ -69,16 +100,34 @@ int main(int argc, char **argv) {
                      {"influxDb", ConfigItem::InfluxDb},
                      {"influxRepeats", ConfigItem::InfluxRepeats},
                      {"cycleRate", ConfigItem::ServerCycleRate},
+                     {"connections", ConfigItem::ServerConnections},
+                     {"aprsServer", ConfigItem::ServerName},
+                     {"aprsPort", ConfigItem::ServerPort},
+                     {"decayHalfLife", ConfigItem::DecayHalfLife},
+                     {"outlierThreshold", ConfigItem::OutlierThreshold},
+                     {"snapshotFile", ConfigItem::SnapshotFile},
+                     {"snapshotInterval", ConfigItem::SnapshotInterval},
+                     {"localName", ConfigItem::LocalName},
+                     {"localWeight", ConfigItem::LocalWeight},
+                     {"localInterval", ConfigItem::LocalInterval},
+                     {"localPort", ConfigItem::LocalPort},
+                     {"localTag", ConfigItem::LocalTag},
+                     {"dhtChip", ConfigItem::DhtChip},
+                     {"dhtLine", ConfigItem::DhtLine},
+                     {"dhtType", ConfigItem::DhtType},
+                     {"filterBudlist", ConfigItem::FilterBudlist},
+                     {"filterDiscovery", ConfigItem::FilterDiscovery},
+                     {"exportStations", ConfigItem::ExportStations},
+                     {"exportInterval", ConfigItem::ExportInterval},
+                     {"exportBatch", ConfigItem::ExportBatch},
              }};
 
-    try {
-        xdg::Environment &environment{xdg::Environment::getEnvironment(true)};
-        filesystem::path configFilePath = environment.appResourcesAppend("config.txt");
-
-        InputParser inputParser{argc, argv};
+    /**
+     * @brief The values read from the configuration file.
+     */
+    struct Configuration {
         std::optional<std::string> callsign{};
         std::optional<std::string> passCode{};
-        std::string filter{};
         std::optional<double> qthLatitude{};
         std::optional<double> qthLongitude{};
         std::optional<long> filterRadius{};
@@ -86,164 +135,570 @@ int main(int argc, char **argv) {
         std::optional<bool> influxTls{false};
         std::optional<bool> influxRepeats{false};
         std::optional<unsigned long> serverCycleRate{100};
+        std::optional<std::size_t> serverConnections{2};
+        std::optional<std::string> serverName{std::string{APRS_IS::DefaultServer}};
+        std::optional<std::string> serverPort{std::string{APRS_IS::DefaultPort}};
+        std::optional<double> decayHalfLife{0.};
+        std::optional<double> outlierThreshold{5.};
+        std::optional<std::string> snapshotFile{};
+        std::optional<unsigned long> snapshotInterval{5};
         std::optional<std::string> influxHost{};
         std::optional<unsigned> influxPort{};
         std::optional<std::string> influxDb{};
+        LocalSensors::Options localOptions{};
+        std::optional<bool> filterBudlist{false};
+        std::optional<unsigned long> filterDiscovery{60};
+        std::optional<bool> exportStations{false};
+        StationExporter::Options exportOptions{};
+
+        [[nodiscard]] bool influxConfigured() const {
+            return influxHost.has_value() && influxPort.has_value() && influxDb.has_value();
+        }
+
+        [[nodiscard]] bool localConfigured() const {
+            return localOptions.dhtChip.has_value() || localOptions.listenPort.has_value();
+        }
+
+        [[nodiscard]] APRS_Position qthPosition() const {
+            APRS_Position position{};
+            position.mLat = qthLatitude;
+            position.mLon = qthLongitude;
+            return position;
+        }
+
+        /// The range filter, see FilterPlanner for the filter sent to the server.
+        [[nodiscard]] std::string rangeFilter() const {
+            std::stringstream filterStrm{};
+            filterStrm << "r/" << qthLatitude.value()
+                       << '/' << qthLongitude.value()
+                       << '/' << filterRadius.value();
+            return filterStrm.str();
+        }
+
+        [[nodiscard]] std::string influxUrl() const {
+            std::stringstream url{};
+            url << (influxTls.value() ? "https" : "http") << "://" << influxHost.value() << ':' << influxPort.value()
+                << "/write?db=" << influxDb.value() << "&precision=s";
+            return url.str();
+        }
+
+        [[nodiscard]] bool sameExport(const Configuration &other) const {
+            return exportStations == other.exportStations &&
+                   exportOptions.minInterval == other.exportOptions.minInterval &&
+                   exportOptions.batchBytes == other.exportOptions.batchBytes;
+        }
+
+        [[nodiscard]] bool sameInflux(const Configuration &other) const {
+            return influxHost == other.influxHost && influxPort == other.influxPort && influxDb == other.influxDb &&
+                   influxTls == other.influxTls;
+        }
+
+        [[nodiscard]] bool sameLocalSensors(const Configuration &other) const {
+            auto &a = localOptions;
+            auto &b = other.localOptions;
+            return std::tie(a.name, a.weight, a.interval, a.dhtChip, a.dhtLine, a.dhtType, a.listenPort, a.tag) ==
+                   std::tie(b.name, b.weight, b.interval, b.dhtChip, b.dhtLine, b.dhtType, b.listenPort, b.tag);
+        }
+    };
+
+    /**
+     * @brief Read the configuration file.
+     * @param path The configuration file path.
+     * @param config Receives the values.
+     * @return false if the file could not be read, held an invalid value or is not configured.
+     */
+    bool readConfiguration(const std::filesystem::path &path, Configuration &config) {
+        ConfigFile configFile{path};
+        if (auto status = configFile.open(); status == ConfigFile::NO_FILE) {
+            cerr << "Configuration file specified " << path << " does not exist.\n";
+            return false;
+        } else if (status == ConfigFile::OPEN_FAIL) {
+            cerr << "Could not open configuration file " << path << ": " << std::strerror(errno) << '\n';
+            return false;
+        }
+
+        bool validFile{true};
+        configFile.process(ConfigSpec, [&](std::size_t idx, const std::string_view &data) {
+            bool validValue{false};
+            switch (static_cast<ConfigItem>(idx)) {
+                case ConfigItem::Callsign:
+                    config.callsign = ConfigFile::parseText(data, [](char c) {
+                        return ConfigFile::isalnum(c) || c == '-';
+                    }, ConfigFile::toupper);
+                    validValue = config.callsign.has_value();
+                    break;
+                case ConfigItem::Passcode:
+                    config.passCode = ConfigFile::parseText(data, ConfigFile::isdigit);
+                    validValue = config.passCode.has_value();
+                    break;
+                case ConfigItem::Latitude:
+                    config.qthLatitude = configFile.safeConvert<double>(data);
+                    validValue = config.qthLatitude.has_value();
+                    break;
+                case ConfigItem::Longitude:
+                    config.qthLongitude = configFile.safeConvert<double>(data);
+                    validValue = config.qthLongitude.has_value();
+                    break;
+                case ConfigItem::Radius:
+                    config.filterRadius = configFile.safeConvert<long>(data);
+                    validValue = config.filterRadius.has_value();
+                    break;
+                case ConfigItem::InfluxTLS:
+                    config.influxTls = ConfigFile::parseBoolean(data);
+                    validValue = config.influxTls.has_value();
+                    break;
+                case ConfigItem::InfluxHost:
+                    config.influxHost = ConfigFile::parseText(data, [](char c) {
+                        return ConfigFile::isalnum(c) || c == '.';
+                    });
+                    validValue = config.influxHost.has_value();
+                    break;
+                case ConfigItem::InfluxPort:
+                    config.influxPort = configFile.safeConvert<long>(data);
+                    validValue = config.influxPort.has_value() && config.influxPort.value() > 0;
+                    break;
+                case ConfigItem::InfluxDb:
+                    config.influxDb = ConfigFile::parseText(data, [](char c) {
+                        return ConfigFile::isalnum(c) || c == '_';
+                    });
+                    validValue = config.influxDb.has_value();
+                    break;
+                case ConfigItem::InfluxRepeats:
+                    config.influxRepeats = ConfigFile::parseBoolean(data);
+                    validValue = config.influxRepeats.has_value();
+                    break;
+                case ConfigItem::ServerCycleRate:
+                    config.serverCycleRate = configFile.safeConvert<unsigned long>(data);
+                    validValue = config.serverCycleRate.has_value();
+                    break;
+                case ConfigItem::ServerConnections:
+                    config.serverConnections = configFile.safeConvert<std::size_t>(data);
+                    validValue = config.serverConnections.has_value() && config.serverConnections.value() > 0 &&
+                                 config.serverConnections.value() <= FeedMerger::MaxConnections;
+                    break;
+                case ConfigItem::ServerName:
+                    config.serverName = ConfigFile::parseText(data, [](char c) {
+                        return ConfigFile::isalnum(c) || c == '.' || c == '-' || c == ':';
+                    });
+                    validValue = config.serverName.has_value();
+                    break;
+                case ConfigItem::ServerPort:
+                    config.serverPort = ConfigFile::parseText(data, ConfigFile::isdigit);
+                    validValue = config.serverPort.has_value();
+                    break;
+                case ConfigItem::DecayHalfLife:
+                    config.decayHalfLife = configFile.safeConvert<double>(data);
+                    validValue = config.decayHalfLife.has_value() && config.decayHalfLife.value() >= 0.;
+                    break;
+                case ConfigItem::OutlierThreshold:
+                    config.outlierThreshold = configFile.safeConvert<double>(data);
+                    validValue = config.outlierThreshold.has_value() && config.outlierThreshold.value() >= 0.;
+                    break;
+                case ConfigItem::SnapshotFile:
+                    config.snapshotFile = ConfigFile::parseText(data, [](char c) {
+                        return ConfigFile::isalnum(c) || c == '/' || c == '.' || c == '_' || c == '-';
+                    });
+                    validValue = config.snapshotFile.has_value();
+                    break;
+                case ConfigItem::SnapshotInterval:
+                    config.snapshotInterval = configFile.safeConvert<unsigned long>(data);
+                    validValue = config.snapshotInterval.has_value() && config.snapshotInterval.value() > 0;
+                    break;
+                case ConfigItem::LocalName:
+                    if (auto name = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '-';
+                        }, ConfigFile::toupper); name.has_value() && name.value().length() < 16) {
+                        config.localOptions.name = name.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::LocalWeight:
+                    if (auto weight = configFile.safeConvert<double>(data); weight.has_value() && weight.value() > 0.) {
+                        config.localOptions.weight = weight.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::LocalInterval:
+                    if (auto interval = configFile.safeConvert<unsigned long>(data);
+                            interval.has_value() && interval.value() > 0) {
+                        config.localOptions.interval = std::chrono::seconds(interval.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::LocalPort:
+                    config.localOptions.listenPort = ConfigFile::parseText(data, ConfigFile::isdigit);
+                    validValue = config.localOptions.listenPort.has_value();
+                    break;
+                case ConfigItem::LocalTag:
+                    if (auto tag = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '=' || c == '_' || c == '-';
+                        }); tag.has_value()) {
+                        config.localOptions.tag = tag.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::DhtChip:
+                    if (auto chip = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '/';
+                        }); chip.has_value()) {
+                        config.localOptions.dhtChip = chip.value();
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::DhtLine:
+                    if (auto line = configFile.safeConvert<unsigned long>(data); line.has_value()) {
+                        config.localOptions.dhtLine = static_cast<unsigned>(line.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::DhtType:
+                    if (data == "DHT11" || data == "DHT22") {
+                        config.localOptions.dhtType = data == "DHT11" ? DhtType::DHT11 : DhtType::DHT22;
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::FilterBudlist:
+                    config.filterBudlist = ConfigFile::parseBoolean(data);
+                    validValue = config.filterBudlist.has_value();
+                    break;
+                case ConfigItem::FilterDiscovery:
+                    config.filterDiscovery = configFile.safeConvert<unsigned long>(data);
+                    validValue = config.filterDiscovery.has_value() && config.filterDiscovery.value() > 0;
+                    break;
+                case ConfigItem::ExportStations:
+                    config.exportStations = ConfigFile::parseBoolean(data);
+                    validValue = config.exportStations.has_value();
+                    break;
+                case ConfigItem::ExportInterval:
+                    if (auto interval = configFile.safeConvert<unsigned long>(data); interval.has_value()) {
+                        config.exportOptions.minInterval = std::chrono::seconds(interval.value());
+                        validValue = true;
+                    }
+                    break;
+                case ConfigItem::ExportBatch:
+                    if (auto batch = configFile.safeConvert<unsigned long>(data); batch.has_value() && batch.value() > 0) {
+                        config.exportOptions.batchBytes = batch.value() * 1024;
+                        validValue = true;
+                    }
+                    break;
+            }
+            validFile = validFile & validValue;
+            if (!validValue) {
+                std::cerr << "Invalid config value: " << ConfigSpec[idx].mKey << '\n';
+            }
+        });
+        configFile.close();
+        if (!validFile) {
+            std::cerr << "Invalid configuration file " << path << '\n';
+            return false;
+        }
+
+        if (config.callsign.has_value() && config.callsign.value().rfind("N0CALL") == 0) {
+            cerr << "Configuration file " << path << " not configured.\n";
+            return false;
+        }
+
+        // Keep readings for a few local report intervals.
+        config.localOptions.maxAge = std::max(config.localOptions.interval * 5, LocalSensors::Options{}.maxAge);
+
+        if (!config.influxConfigured())
+            std::cerr << "Influx database not specified in " << path << ", data will not be stored.\n";
+        return true;
+    }
+}
+
+int main(int argc, char **argv) {
+    static constexpr std::string_view ConfigOption = "--config";
+
+    try {
+        xdg::Environment &environment{xdg::Environment::getEnvironment(true)};
+        filesystem::path configFilePath = environment.appResourcesAppend("config.txt");
+
+        InputParser inputParser{argc, argv};
 
         std::signal(SIGINT, signalHandler);
         std::signal(SIGTERM, signalHandler);
-        std::signal(SIGHUP, signalHandler);
+        std::signal(SIGHUP, hangupHandler);
 
         WeatherAggregator weatherAggregator{};
 
         if (inputParser.cmdOptionExists(ConfigOption))
             configFilePath = std::filesystem::path{inputParser.getCmdOption(ConfigOption)};
 
-        ConfigFile configFile{configFilePath};
-        if (auto status = configFile.open(); status == ConfigFile::OK) {
-            bool validFile{true};
-            configFile.process(ConfigSpec, [&](std::size_t idx, const std::string_view &data) {
-                bool validValue{false};
-                switch (static_cast<ConfigItem>(idx)) {
-                    case ConfigItem::Callsign:
-                        callsign = ConfigFile::parseText(data, [](char c) {
-                            return ConfigFile::isalnum(c) || c == '-';
-                        }, ConfigFile::toupper);
-                        validValue = callsign.has_value();
-                        break;
-                    case ConfigItem::Passcode:
-                        passCode = ConfigFile::parseText(data, ConfigFile::isdigit);
-                        validValue = passCode.has_value();
-                        break;
-                    case ConfigItem::Latitude:
-                        qthLatitude = configFile.safeConvert<double>(data);
-                        validValue = qthLatitude.has_value();
-                        break;
-                    case ConfigItem::Longitude:
-                        qthLongitude = configFile.safeConvert<double>(data);
-                        validValue = qthLongitude.has_value();
-                        break;
-                    case ConfigItem::Radius:
-                        filterRadius = configFile.safeConvert<long>(data);
-                        validValue = filterRadius.has_value();
-                        break;
-                    case ConfigItem::InfluxTLS:
-                        influxTls = ConfigFile::parseBoolean(data);
-                        validValue = influxTls.has_value();
-                        break;
-                    case ConfigItem::InfluxHost:
-                        influxHost = ConfigFile::parseText(data, [](char c) {
-                            return ConfigFile::isalnum(c) || c == '.';
-                        });
-                        validValue = influxHost.has_value();
-                        break;
-                    case ConfigItem::InfluxPort:
-                        influxPort = configFile.safeConvert<long>(data);
-                        validValue = influxPort.has_value() && influxPort.value() > 0;
-                        break;
-                    case ConfigItem::InfluxDb:
-                        influxDb = ConfigFile::parseText(data, [](char c) {
-                            return ConfigFile::isalnum(c) || c == '_';
-                        });
-                        validValue = influxDb.has_value();
-                        break;
-                    case ConfigItem::InfluxRepeats:
-                        influxRepeats = ConfigFile::parseBoolean(data);
-                        validValue = influxRepeats.has_value();
-                        break;
-                    case ConfigItem::ServerCycleRate:
-                        serverCycleRate = configFile.safeConvert<unsigned long>(data);
-                        validValue = serverCycleRate.has_value();
-                        break;
-                }
-                validFile = validFile & validValue;
-                if (!validValue) {
-                    std::cerr << "Invalid config value: " << ConfigSpec[idx].mKey << '\n';
-                }
+        Configuration config{};
+        if (!readConfiguration(configFilePath, config))
+            exit(1);
+
+        // Half life is configured in minutes.
+        weatherAggregator.setDecayHalfLife(config.decayHalfLife.value_or(0.) * 60.);
+        weatherAggregator.setOutlierThreshold(config.outlierThreshold.value_or(0.));
+
+        // Restore the station table saved by the last run so the aggregate does not start cold.
+        if (config.snapshotFile.has_value()) {
+            auto restored = weatherAggregator.loadSnapshot(config.snapshotFile.value(), config.qthPosition(),
+                                                           static_cast<double>(config.filterRadius.value()));
+            cerr << "Restored " << restored << " station reports from " << config.snapshotFile.value() << '\n';
+        }
+        auto snapshotTime = std::chrono::steady_clock::now();
+        std::future<bool> snapshotWrite{};
+
+        FilterPlanner filterPlanner{};
+        auto configureFilter = [&]() {
+            filterPlanner.configure(config.rangeFilter(), config.filterBudlist.value(),
+                                    std::chrono::minutes(config.filterDiscovery.value()));
+        };
+        configureFilter();
+
+        // Raw station reports, posted in compressed batches from their own thread.
+        std::unique_ptr<StationExporter> stationExporter{};
+        auto startExport = [&]() {
+            stationExporter.reset();
+            if (config.exportStations.value() && config.influxConfigured())
+                stationExporter = std::make_unique<StationExporter>(config.influxUrl(), config.exportOptions);
+        };
+        startExport();
+
+        // Local sensors report from their own thread, the aggregator and configuration are shared with the
+        // packet loop under the mutex.
+        std::mutex aggregatorMutex{};
+        std::unique_ptr<LocalSensors> localSensors{};
+        auto startLocalSensors = [&]() {
+            if (!config.localConfigured())
+                return;
+            localSensors = std::make_unique<LocalSensors>(config.localOptions, config.qthPosition(),
+                                                          [&](std::unique_ptr<APRS_WX_Report> report) {
+                std::lock_guard<std::mutex> lock{aggregatorMutex};
+                weatherAggregator.addReport(*report);
+                if (config.influxConfigured())
+                    weatherAggregator.pushToInflux(config.influxHost.value(), config.influxTls.value(),
+                                                   config.influxPort.value(), config.influxDb.value());
             });
-            configFile.close();
-            if (!validFile) {
-                std::cerr << "Invalid configuration file " << configFilePath << " exiting.\n";
+            if (localSensors->valid())
+                localSensors->start();
+            else
+                cerr << "No local sensors could be opened.\n";
+        };
+        startLocalSensors();
+
+        /*
+         * Apply a changed configuration file without dropping the station table or, where possible, the
+         * server connections. Returns true if the connections must be reopened for a new login.
+         */
+        auto reconfigure = [&](APRS_IS &sock) {
+            Configuration next{};
+            if (!readConfiguration(configFilePath, next)) {
+                cerr << "Keeping the current configuration.\n";
+                return false;
             }
 
-            if (!(influxHost.has_value() && influxPort.has_value() && influxDb.has_value()))
-                std::cerr << "Influx database not specified in " << configFilePath << ", data will not be stored.\n";
-        } else if (status == ConfigFile::NO_FILE) {
-            cerr << "Configuration file specified " << configFilePath << " does not exist.\n";
-            exit(1);
-        } else if (status == ConfigFile::OPEN_FAIL) {
-            cerr << "Could not open configuration file " << configFilePath << ": "
-                 << std::strerror(errno) << '\n';
-            exit(1);
-        }
+            bool relogin = next.callsign != config.callsign || next.passCode != config.passCode ||
+                           next.serverConnections != config.serverConnections ||
+                           next.serverCycleRate != config.serverCycleRate ||
+                           next.serverName != config.serverName || next.serverPort != config.serverPort;
+            bool moved = next.qthLatitude != config.qthLatitude || next.qthLongitude != config.qthLongitude ||
+                         next.filterRadius != config.filterRadius;
+            bool restartLocal = moved || !next.sameLocalSensors(config);
+            bool restartExport = !next.sameInflux(config) || !next.sameExport(config);
 
-        if (callsign.has_value() && callsign.value().rfind("N0CALL") == 0) {
-            cerr << "Configuration file " << configFilePath << " not configured.\n";
-            exit(1);
-        }
+            // Stopped outside the lock, the sampling thread may be waiting for it.
+            if (restartLocal)
+                localSensors.reset();
+
+            {
+                std::lock_guard<std::mutex> lock{aggregatorMutex};
+                if (next.decayHalfLife != config.decayHalfLife)
+                    weatherAggregator.setDecayHalfLife(next.decayHalfLife.value_or(0.) * 60.);
+                if (next.outlierThreshold != config.outlierThreshold)
+                    weatherAggregator.setOutlierThreshold(next.outlierThreshold.value_or(0.));
+                if (moved) {
+                    weatherAggregator.setLocation(next.qthPosition(), static_cast<double>(next.filterRadius.value()));
+                    cerr << "Location or radius changed, " << weatherAggregator.size() << " station reports kept.\n";
+                }
+                if (!next.sameInflux(config))
+                    cerr << "Influx target changed to " << next.influxHost.value_or("none") << ':'
+                         << next.influxPort.value_or(0) << '/' << next.influxDb.value_or("none") << '\n';
+                config = std::move(next);
+            }
 
-        std::stringstream filterStrm{};
-        filterStrm << "r/" << qthLatitude.value()
-                   << '/' << qthLongitude.value()
-                   << '/' << filterRadius.value();
+            if (restartLocal)
+                startLocalSensors();
+            if (restartExport)
+                startExport();
 
-        filter = filterStrm.str();
+            sock.mQthPosition = config.qthPosition();
+            sock.mRadius = config.filterRadius;
+            configureFilter();
+            if (relogin)
+                cerr << "Login, server or connections changed, reconnecting.\n";
+            return relogin;
+        };
+
+        auto decoderContext = std::make_shared<DecoderContext>();
+        PacketClassifier packetClassifier{};
+        PacketPool packetPool{};
+
+        // Packets from every connection are decoded here, this socket is never connected.
+        APRS_IS decoder{config.callsign.value(), config.passCode.value(), filterPlanner.filter()};
+        decoder.mQthPosition = config.qthPosition();
+        decoder.mRadius = config.filterRadius;
+        decoder.mContext = decoderContext;
 
         std::cerr << "Hello, CWOP APRS-IS!" << '\n'
-                  << callsign.value()
-                  << ' ' << filter << '\n';
+                  << config.callsign.value() << ' ' << config.serverName.value() << ':' << config.serverPort.value()
+                  << ' ' << filterPlanner.filter() << '\n';
 
+        std::unique_ptr<FeedMerger> feeds{};
+        auto openFeeds = [&]() {
+            feeds.reset();
+            feeds = std::make_unique<FeedMerger>(config.serverName.value(), config.serverPort.value(),
+                                                 config.serverConnections.value(), config.callsign.value(),
+                                                 config.passCode.value(), filterPlanner.filter(),
+                                                 config.serverCycleRate.value());
+        };
+        openFeeds();
+
+        // Packets taken from the merged feed since the statistics were last printed, the end to end rate.
+        unsigned long packetCount = 0;
+        auto statisticsTime = std::chrono::steady_clock::now();
+        auto printStatistics = [&]() {
+            auto now = std::chrono::steady_clock::now();
+            std::chrono::duration<double> elapsed = now - statisticsTime;
+            if (elapsed.count() > 0.)
+                cerr << "Processed " << packetCount << " packets, "
+                     << std::lround(static_cast<double>(packetCount) / elapsed.count()) << " packets/s\n";
+            packetCount = 0;
+            statisticsTime = now;
+            cerr << "Decoding errors: " << decoderContext->mDecodeErrors
+                 << " weather without position: " << decoderContext->mNoPosition << " unhandled:";
+            for (auto &[discriminator, count] : decoderContext->mUnhandled)
+                cerr << " '" << discriminator << "' " << count;
+            cerr << "\nPackets";
+            for (std::size_t idx = 0; idx < PacketClassCount; ++idx) {
+                auto packetClass = static_cast<PacketClass>(idx);
+                cerr << ' ' << PacketClassifier::className(packetClass) << ": " << packetClassifier.count(packetClass);
+            }
+            cerr << '\n';
+            feeds->report(cerr);
+        };
+
+        std::string line{};
         while (run) {
-            APRS_IS sock{callsign.value(), passCode.value(), filter};
-            sock.mQthPosition.mLat = qthLatitude;
-            sock.mQthPosition.mLon = qthLongitude;
-            sock.mRadius = filterRadius;
-
-            unsigned long packetCount = 0;
-
-            if (sock.openConnection()) {
-                while (packetCount < serverCycleRate.value()) {
-                    sock.getPacket();
-
-                    if (!sock.mPacket.empty()) {
-                        std::cerr << sock.mPacket;
-                        ++packetCount;
-                        if (!sock.prefix("# aprsc")) {
-                            if (sock.charAtIndex() != '#') {
-                                auto packet = sock.decode();
-                                switch (packet->status()) {
-                                    case PacketStatus::WxPacket: {
-                                        auto wx = std::unique_ptr<APRS_WX_Report>(
-                                                dynamic_cast<APRS_WX_Report *>(packet.release()));
-                                        weatherAggregator[wx->mName] = std::move(wx);
-                                        weatherAggregator.aggregateData();
-                                        if (influxHost.has_value() && influxPort.has_value() && influxDb.has_value())
-                                            weatherAggregator.pushToInflux(influxHost.value(), influxTls.value(),
-                                                                           influxPort.value(), influxDb.value());
-                                    }
-                                        break;
-                                    case PacketStatus::DecodingError:
-                                        cerr << "Packet decoding error.\n";
-                                        return 1;
-                                    default:
-                                        break;
-                                }
-                            }
-                        } else {
-                            if (influxRepeats.value() && !weatherAggregator.empty() && influxHost.has_value() &&
-                                influxPort.has_value() && influxDb.has_value())
-                                weatherAggregator.pushToInflux(influxHost.value(), influxTls.value(),
-                                                               influxPort.value(), influxDb.value());
+            bool received = feeds->next(line, std::chrono::seconds(1));
+
+            if (reload.exchange(false)) {
+                cerr << "Reloading configuration " << configFilePath << '\n';
+                if (reconfigure(decoder))
+                    openFeeds();
+            }
+
+            // Send the filter to the servers when it changes, without reconnecting.
+            if (auto &filter = filterPlanner.filter(); filter != feeds->filter()) {
+                feeds->setFilter(filter);
+                cerr << "Filter changed to " << filter << '\n';
+            }
+
+            // The loop wakes at least once a second. The station table is copied under the lock and written
+            // from its own thread, a slow fsync must not hold up packets or the local sensors.
+            if (auto now = std::chrono::steady_clock::now(); config.snapshotFile.has_value() &&
+                    now - snapshotTime > std::chrono::minutes(config.snapshotInterval.value()) &&
+                    (!snapshotWrite.valid() ||
+                     snapshotWrite.wait_for(std::chrono::seconds(0)) == std::future_status::ready)) {
+                std::vector<SnapshotRecord> records{};
+                {
+                    std::lock_guard<std::mutex> lock{aggregatorMutex};
+                    records = weatherAggregator.snapshot();
+                }
+                snapshotWrite = std::async(std::launch::async, [path = config.snapshotFile.value(),
+                                                                 records = std::move(records)]() {
+                    return WeatherAggregator::writeSnapshot(path, records);
+                });
+                snapshotTime = now;
+            }
+
+            if (!received)
+                continue;
+
+            decoder.setPacket(std::move(line));
+            filterPlanner.count(decoder.mPacket.size());
+
+            // Most of the feed is not weather, drop it before decoding.
+            auto classification = packetClassifier.classify(decoder.mPacket);
+            switch (classification.packetClass) {
+                case PacketClass::Comment:
+                    std::cerr << decoder.mPacket;
+                    if (stationExporter)
+                        stationExporter->flushIfDue();
+                    if (decoder.prefix("# aprsc")) {
+                        std::lock_guard<std::mutex> lock{aggregatorMutex};
+                        if (config.influxRepeats.value() && !weatherAggregator.empty() &&
+                            config.influxConfigured())
+                            weatherAggregator.pushToInflux(config.influxHost.value(),
+                                                           config.influxTls.value(),
+                                                           config.influxPort.value(),
+                                                           config.influxDb.value());
+                    }
+                    break;
+                case PacketClass::Position:
+                    if (!decoderContext->tracksPosition(classification.name))
+                        break;
+                    [[fallthrough]];
+                case PacketClass::Weather: {
+                    std::cerr << decoder.mPacket;
+                    auto packet = packetPool.acquire();
+                    switch (decoder.decode(classification, *packet)) {
+                        case PacketStatus::WxPacket: {
+                            auto &wx = std::get<APRS_WX_Report>(*packet);
+                            filterPlanner.learn(wx.mName);
+                            std::lock_guard<std::mutex> lock{aggregatorMutex};
+                            weatherAggregator.addReport(wx);
+                            // Exported after screening so rejected values are marked.
+                            if (auto found = weatherAggregator.find(wx.mName);
+                                    stationExporter && found != weatherAggregator.end())
+                                stationExporter->add(found->second);
+                            if (config.influxConfigured())
+                                weatherAggregator.pushToInflux(config.influxHost.value(), config.influxTls.value(),
+                                                               config.influxPort.value(), config.influxDb.value());
                         }
-                    } else {
-                        std::cerr << "*** Empty packet.\n";
-                        packetCount = serverCycleRate.value();
+                            break;
+                        case PacketStatus::NoPosition:
+                            // Budlisted, the station's next position will come through.
+                            filterPlanner.learn(packetBase(*packet).mName);
+                            ++decoderContext->mNoPosition;
+                            break;
+                        case PacketStatus::DecodingError:
+                        case PacketStatus::ErrorLatitude:
+                        case PacketStatus::ErrorLongitude:
+                            cerr << "Packet decoding error.\n";
+                            ++decoderContext->mDecodeErrors;
+                            break;
+                        default:
+                            break;
                     }
                 }
+                    break;
+                case PacketClass::Other:
+                    ++decoderContext->mUnhandled[classification.dti];
+                    break;
+                case PacketClass::Malformed:
+                    ++decoderContext->mDecodeErrors;
+                    break;
             }
 
-            sock.close();
+            // Statistics at the rate they were printed when one server was cycled.
+            if (++packetCount >= config.serverCycleRate.value())
+                printStatistics();
         }
+
+        feeds->stop();
+        printStatistics();
+
+        if (localSensors)
+            localSensors->stop();
+
+        if (snapshotWrite.valid())
+            snapshotWrite.wait();
+        if (config.snapshotFile.has_value())
+            weatherAggregator.saveSnapshot(config.snapshotFile.value());
     } catch (exception &e) {
         cerr << e.what() << '\n';
         return 1;
@@ -0,0 +1,157 @@
+//
+// Created by richard on 2021-09-18.
+//
+
+/**
+ * @file dht_read.cpp
+ * @brief Read a DHT11 or DHT22 sensor and print the result.
+ * @details Usage: DHT_READ [--chip /dev/gpiochip0] [--line 4] [--pigpio] [--type DHT11|DHT22] [--loop]
+ * [--trace file] [--selftest]. With --trace the recorded edge trace is decoded instead of reading a sensor.
+ * With --selftest synthesised frames are decoded, and read through DhtSensor to check retries and caching.
+ */
+
+#include <cmath>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <thread>
+#include "InputParser.h"
+#include "DhtSensor.h"
+
+/**
+ * @brief Decode frames from SimulatedGpio::frame(), and read them through DhtSensor, checking the results.
+ * @return The number of failed checks.
+ */
+static int selfTest() {
+    int failures = 0;
+    auto result = [&](std::string_view name, bool pass) {
+        std::cout << (pass ? "pass " : "FAIL ") << name << '\n';
+        if (!pass)
+            ++failures;
+    };
+    auto matches = [](const std::optional<DhtReading> &reading, std::optional<std::pair<double, double>> expected) {
+        if (reading.has_value() != expected.has_value())
+            return false;
+        return !reading || (std::abs(reading->temperature - expected->first) < 0.01 &&
+                            std::abs(reading->humidity - expected->second) < 0.01);
+    };
+    auto check = [&](std::string_view name, const std::vector<GpioEdge> &edges, DhtType type,
+                     std::optional<std::pair<double, double>> expected) {
+        result(name, matches(decodeDht(edges, type), expected));
+    };
+
+    // 65.2% and 23.1C, checksum 0x75.
+    auto good = SimulatedGpio::frame({0x02, 0x8C, 0x00, 0xE7, 0x75});
+    auto bad = SimulatedGpio::frame({0x02, 0x8C, 0x00, 0xE7, 0x76});
+    auto expected = std::make_pair(23.1, 65.2);
+    check("DHT22 good checksum", good, DhtType::DHT22, expected);
+    check("DHT22 bad checksum", bad, DhtType::DHT22, std::nullopt);
+    check("DHT22 negative temperature", SimulatedGpio::frame({0x02, 0x8C, 0x80, 0x69, 0x77}), DhtType::DHT22,
+          std::make_pair(-10.5, 65.2));
+    check("DHT11 good checksum", SimulatedGpio::frame({45, 0, 22, 0, 67}), DhtType::DHT11,
+          std::make_pair(22., 45.));
+
+    // The frame is found working back from the end, a capture which missed the preamble still decodes,
+    // one which also missed the first data bit does not.
+    std::vector<GpioEdge> missed{good.begin() + 2, good.end()};
+    check("Missed preamble", missed, DhtType::DHT22, expected);
+    missed.erase(missed.begin(), missed.begin() + 2);
+    check("Missed first bit", missed, DhtType::DHT22, std::nullopt);
+
+    check("All zero frame", SimulatedGpio::frame({0, 0, 0, 0, 0}), DhtType::DHT22, std::nullopt);
+
+    // The sensor tests use a short rest time, the simulated line repeats its last trace.
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds MinInterval{50};
+    auto sensor = [&](std::initializer_list<std::vector<GpioEdge>> traces) {
+        auto gpio = std::make_unique<SimulatedGpio>();
+        for (auto &trace : traces)
+            gpio->add(trace);
+        return DhtSensor{std::move(gpio), DhtType::DHT22, 2, MinInterval};
+    };
+
+    {
+        auto retried = sensor({bad, good});
+        auto start = Clock::now();
+        auto reading = retried.read();
+        result("Retry after a bad frame", matches(reading, expected) && retried.failures() == 1);
+        result("Retry waits out the minimum interval", Clock::now() - start >= MinInterval);
+    }
+
+    {
+        auto cached = sensor({good, bad});
+        auto first = cached.read();
+        auto second = cached.read();
+        result("Read inside the minimum interval is cached",
+               matches(second, expected) && first && second->time == first->time && cached.failures() == 0);
+
+        // Past the interval the line only gives bad frames, every retry fails.
+        std::this_thread::sleep_for(MinInterval);
+        result("Read fails after all retries", !cached.read() && cached.failures() == 3);
+        auto fallback = cached.read(std::chrono::seconds{1});
+        result("Failed read falls back to a reading within maxAge",
+               matches(fallback, expected) && fallback->time == first->time && cached.failures() == 6);
+    }
+    return failures;
+}
+
+int main(int argc, char **argv) {
+    InputParser inputParser{argc, argv};
+
+    if (inputParser.cmdOptionExists("--selftest"))
+        return selfTest() == 0 ? 0 : 1;
+
+    auto option = [&](std::string_view name, std::string_view defaultValue) {
+        return inputParser.cmdOptionExists(name) ? std::string{inputParser.getCmdOption(name)}
+                                                 : std::string{defaultValue};
+    };
+
+    auto type = option("--type", "DHT22") == "DHT11" ? DhtType::DHT11 : DhtType::DHT22;
+    auto line = static_cast<unsigned>(std::stoul(option("--line", "4")));
+    bool loop = inputParser.cmdOptionExists("--loop");
+
+    std::unique_ptr<GpioBackend> gpio{};
+    auto minInterval = DhtSensor::MinInterval;
+    if (inputParser.cmdOptionExists("--trace")) {
+        auto simulated = std::make_unique<SimulatedGpio>();
+        if (!simulated->load(inputParser.getCmdOption("--trace"))) {
+            std::cerr << "Could not read trace " << inputParser.getCmdOption("--trace") << '\n';
+            return 1;
+        }
+        gpio = std::move(simulated);
+        minInterval = std::chrono::milliseconds{0};
+        loop = false;
+    } else if (inputParser.cmdOptionExists("--pigpio")) {
+#ifdef HAVE_PIGPIO
+        auto pigpio = std::make_unique<PigpioGpio>(line);
+        if (!pigpio->valid()) {
+            std::cerr << "pigpio could not be initialised.\n";
+            return 1;
+        }
+        gpio = std::move(pigpio);
+#else
+        std::cerr << "Built without pigpio.\n";
+        return 1;
+#endif
+    } else {
+        auto chardev = std::make_unique<GpioChardev>(option("--chip", "/dev/gpiochip0"), line);
+        if (!chardev->valid()) {
+            std::cerr << "Could not open " << option("--chip", "/dev/gpiochip0") << '\n';
+            return 1;
+        }
+        gpio = std::move(chardev);
+    }
+
+    DhtSensor sensor{std::move(gpio), type, 2, minInterval};
+    do {
+        if (auto reading = sensor.read(); reading)
+            std::cout << std::fixed << std::setprecision(1) << "Temperature: " << reading->temperature
+                      << "C Humidity: " << reading->humidity << "%\n";
+        else
+            std::cout << "Data invalid after " << sensor.failures() << " failed attempts.\n";
+        if (loop)
+            std::this_thread::sleep_for(minInterval);
+    } while (loop);
+
+    return 0;
+}
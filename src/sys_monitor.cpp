@@ -3,20 +3,28 @@
 //
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
 #include <string>
 #include <string_view>
 #include <filesystem>
 #include <csignal>
 #include <atomic>
 #include <system_error>
-#include <curlpp/cURLpp.hpp>
-#include <curlpp/Easy.hpp>
-#include <curlpp/Options.hpp>
-#include <curlpp/Exception.hpp>
+#include <chrono>
+#include <cstdint>
+#include <poll.h>
 #include "unixstd.h"
 #include "InputParser.h"
 #include "XDGFilePaths.h"
 #include "ConfigFile.h"
+#include "Collector.h"
+#include "LineProtocol.h"
+#include "Summarizer.h"
+#include "Scheduler.h"
+#include "InfluxPusher.h"
+#include "PressureCollector.h"
 
 using namespace std;
 using namespace unixstd;
@@ -32,105 +40,15 @@ void signalHandler(int signum) {
     run = false;
 }
 
-/**
- * @class CpuStats
- * @brief A Class to fetch, process and store CPU operating statistics.
- */
-class CpuStats {
-public:
-    using ProcStatDataType = unsigned long long;    ///< Type to store stats data in
-
-protected:
-    enum Item {
-        User,
-        Nice,
-        System,
-        Idle,
-        IOWait,
-        IRQ,
-        SoftIRQ,
-        Steal,
-        Guest,
-        GuestNice,
-        ItemCount   // Must be last.
-    };
-
-    std::string mName{};
-    static constexpr std::string_view mProcStatFile {"/proc/stat"};
-    std::filesystem::path mProcStatPath{};
-    std::array<ProcStatDataType, static_cast<std::size_t>(ItemCount)> mData{};
-    std::array<ProcStatDataType, static_cast<std::size_t>(ItemCount)> mPastData{};
-
-public:
-    CpuStats() {
-        mProcStatPath = mProcStatFile;
-        for (auto &item : mData) {
-            item = 0;
-        }
-    }
-
-    bool getData() {
-        std::ifstream ifs;
-        ifs.open(mProcStatPath, std::ofstream::in);
-        if (ifs) {
-            std::string line{};
-            std::getline(ifs, line);
-            ifs.close();
-            auto line_view = std::string_view{line};
-            auto p = line_view.find(' ');
-            mName = line_view.substr(0, p);
-            p = line_view.find_first_of("0123456789", p);
-            auto idx = static_cast<std::size_t>(User);
-            while (p != std::string_view::npos && idx < static_cast<std::size_t>(ItemCount)) {
-                ProcStatDataType value{};
-                auto [ptr, ec] {std::from_chars(line_view.begin()+p, line_view.end(), value)};
-                if (ec == std::errc()) {
-                    mData[static_cast<std::size_t>(idx)] = value;
-                    p = line_view.find_first_of("0123456789", ptr - line_view.data());
-                    ++idx;
-                } else if (ec == std::errc::invalid_argument) {
-                    std::cerr << "CPU Stat invalid argument\n";
-                    return false;
-                } else if (ec == std::errc::result_out_of_range) {
-                    std::cerr << "CPU Stat result out of range\n";
-                    return false;
-                }
-            }
-        }
-
-        return true;
-    }
-
-    void setPastData() {
-        mPastData = mData;
-    }
-
-    [[nodiscard]] std::tuple<ProcStatDataType,ProcStatDataType> getUsage() const {
-        ProcStatDataType used{}, idle{};
-        for (auto idx = static_cast<std::size_t>(User); idx < static_cast<std::size_t>(ItemCount); ++idx) {
-            switch (static_cast<Item>(idx)) {
-                case Idle:
-                case IOWait:
-                    idle += mData[static_cast<std::size_t>(idx)] - mPastData[static_cast<std::size_t>(idx)];
-                    break;
-                case User:
-                case Nice:
-                case System:
-                case IRQ:
-                case SoftIRQ:
-                case Steal:
-                case Guest:
-                case GuestNice:
-                case ItemCount:
-                    break;
-                default:
-                    used += mData[static_cast<std::size_t>(idx)] - mPastData[static_cast<std::size_t>(idx)];
-            }
-        }
-
-        return std::make_tuple(used, idle);
+/// Append the entries of a comma separated list to a vector.
+static void splitList(std::string_view list, std::vector<std::string> &entries) {
+    while (!list.empty()) {
+        auto comma = list.find(',');
+        if (auto entry = list.substr(0, comma); !entry.empty())
+            entries.emplace_back(entry);
+        list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
     }
-};
+}
 
 int main(int argc, char **argv) {
     static constexpr std::string_view ConfigOption = "--config";
@@ -141,6 +59,17 @@ int main(int argc, char **argv) {
         InfluxPort,
         InfluxDb,
         CPUZone,
+        Collectors,
+        Filesystems,
+        SampleInterval,
+        PushInterval,
+        TopProcesses,
+        Units,
+        PressureTrigger,
+        BurstDuration,
+        BufferSize,
+        SpoolFile,
+        SpoolSize,
     };
 
     std::vector<ConfigFile::Spec> ConfigSpec
@@ -149,7 +78,18 @@ int main(int argc, char **argv) {
                      {"influxHost", ConfigItem::InfluxHost},
                      {"influxPort", ConfigItem::InfluxPort},
                      {"influxDb", ConfigItem::InfluxDb},
-                     {"cpuZone", ConfigItem::CPUZone}
+                     {"cpuZone", ConfigItem::CPUZone},
+                     {"collectors", ConfigItem::Collectors},
+                     {"filesystems", ConfigItem::Filesystems},
+                     {"sampleInterval", ConfigItem::SampleInterval},
+                     {"pushInterval", ConfigItem::PushInterval},
+                     {"topProcesses", ConfigItem::TopProcesses},
+                     {"units", ConfigItem::Units},
+                     {"pressureTrigger", ConfigItem::PressureTrigger},
+                     {"burstDuration", ConfigItem::BurstDuration},
+                     {"bufferSize", ConfigItem::BufferSize},
+                     {"spoolFile", ConfigItem::SpoolFile},
+                     {"spoolSize", ConfigItem::SpoolSize}
              }};
 
     try {
@@ -175,8 +115,13 @@ int main(int argc, char **argv) {
         std::optional<std::string> influxHost{};
         std::optional<long> influxPort{};
         std::optional<std::string> influxDb{};
-        filesystem::path cpuZone{};
-        CpuStats cpuStats{};
+        std::optional<std::string> collectors{};
+        std::optional<unsigned long> sampleInterval{};  // Milliseconds, when not set sample once per push.
+        unsigned long pushInterval{30};                 // Seconds
+        unsigned long burstDuration{60};                // Seconds
+        InfluxPusher::Options pushOptions{};
+        CollectorConfig collectorConfig{};
+        collectorConfig.host = Hostname::name();
 
         // Catch signals
         std::signal(SIGINT, signalHandler);
@@ -214,12 +159,91 @@ int main(int argc, char **argv) {
                         validValue = influxDb.has_value();
                         break;
                     case ConfigItem::CPUZone:
+                        collectorConfig.cpuZone = configFile.safeConvert<long>(data);
+                        validValue = collectorConfig.cpuZone.has_value();
+                        break;
+                    case ConfigItem::Collectors:
+                        collectors = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == ',';
+                        });
+                        validValue = collectors.has_value();
+                        break;
+                    case ConfigItem::Filesystems: {
+                        auto paths = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '/' || c == '.' || c == '_' || c == '-' || c == ',';
+                        });
+                        validValue = paths.has_value();
+                        if (validValue)
+                            splitList(paths.value(), collectorConfig.filesystems);
+                    }
+                        break;
+                    case ConfigItem::SampleInterval:
+                        sampleInterval = configFile.safeConvert<unsigned long>(data);
+                        validValue = sampleInterval.has_value() && sampleInterval.value() > 0;
+                        break;
+                    case ConfigItem::PushInterval: {
+                        auto value = configFile.safeConvert<unsigned long>(data);
+                        validValue = value.has_value() && value.value() > 0;
+                        if (validValue)
+                            pushInterval = value.value();
+                    }
+                        break;
+                    case ConfigItem::TopProcesses: {
+                        auto value = configFile.safeConvert<unsigned long>(data);
+                        validValue = value.has_value() && value.value() > 0;
+                        if (validValue)
+                            collectorConfig.topProcesses = value.value();
+                    }
+                        break;
+                    case ConfigItem::Units: {
+                        auto units = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '.' || c == '_' || c == '-' || c == '@' || c == ',';
+                        });
+                        validValue = units.has_value();
+                        if (validValue)
+                            splitList(units.value(), collectorConfig.units);
+                    }
+                        break;
+                    case ConfigItem::PressureTrigger: {
+                        // Milliseconds of stall per trigger window.
                         auto value = configFile.safeConvert<long>(data);
-                        if (validValue = value.has_value(); validValue) {
-                            stringstream strm{};
-                            strm << "/sys/class/thermal/thermal_zone" << value.value() << "/temp";
-                            cpuZone = strm.str();
-                        }
+                        validValue = value.has_value() && value.value() > 0 &&
+                                     value.value() * 1000 < PressureCollector::TriggerWindow;
+                        if (validValue)
+                            collectorConfig.pressureTrigger = value.value() * 1000;
+                    }
+                        break;
+                    case ConfigItem::BurstDuration: {
+                        auto value = configFile.safeConvert<unsigned long>(data);
+                        validValue = value.has_value();
+                        if (validValue)
+                            burstDuration = value.value();
+                    }
+                        break;
+                    case ConfigItem::BufferSize: {
+                        // KiB held in memory while the server is unreachable.
+                        auto value = configFile.safeConvert<unsigned long>(data);
+                        validValue = value.has_value() && value.value() > 0;
+                        if (validValue)
+                            pushOptions.maxMemory = value.value() * 1024;
+                    }
+                        break;
+                    case ConfigItem::SpoolFile: {
+                        auto path = ConfigFile::parseText(data, [](char c) {
+                            return ConfigFile::isalnum(c) || c == '/' || c == '.' || c == '_' || c == '-';
+                        });
+                        validValue = path.has_value();
+                        if (validValue)
+                            pushOptions.spoolPath = path.value();
+                    }
+                        break;
+                    case ConfigItem::SpoolSize: {
+                        // MiB held on disk once the memory buffer is full.
+                        auto value = configFile.safeConvert<unsigned long>(data);
+                        validValue = value.has_value() && value.value() > 0;
+                        if (validValue)
+                            pushOptions.maxSpool = value.value() * 1024 * 1024;
+                    }
                         break;
                 }
                 validFile = validFile & validValue;
@@ -236,72 +260,138 @@ int main(int argc, char **argv) {
             if (!(influxHost.has_value() && influxPort.has_value() && influxDb.has_value()))
                 std::cerr << "Influx database not specified in " << configFilePath << ", data will not be stored.\n";
 
-            if (!filesystem::exists(cpuZone))
-                cpuZone.clear();
+            // Without a collectors entry report what earlier versions did, cpu use and temperature.
+            CollectorRegistry registry{};
+            registry.addList(collectors.value_or("cpu,temp"), collectorConfig);
+            if (registry.empty()) {
+                cerr << "No active measurements, exiting\n";
+                return 1;
+            }
 
-            // Build the influx server URL
-            stringstream url{};
-            url << (influxTls? "https" : "http") << "://" << influxHost.value() << ':'
-                << influxPort.value() << "/write?db=" << influxDb.value();
+            // Build the influx server URL, timestamps are sent in milliseconds.
+            std::string url{influxTls ? "https" : "http"};
+            url.append("://").append(influxHost.value()).append(":").append(std::to_string(influxPort.value()))
+                    .append("/write?db=").append(influxDb.value()).append("&precision=ms");
+
+            // The encoding buffer is reused for every push.
+            LineProtocol lineProtocol{};
+
+            // With a sample interval shorter than the push interval samples are summarized at each push.
+            // The push interval is rounded to a whole number of sample intervals.
+            std::chrono::milliseconds pushPeriod{std::chrono::seconds{pushInterval}};
+            std::chrono::milliseconds samplePeriod{
+                    std::min<std::chrono::milliseconds::rep>(
+                            static_cast<std::chrono::milliseconds::rep>(sampleInterval.value_or(pushInterval * 1000)),
+                            pushPeriod.count())};
+            auto ticksPerPush = static_cast<std::uint64_t>(pushPeriod / samplePeriod);
+            if (pushPeriod % samplePeriod != std::chrono::milliseconds::zero())
+                cerr << "pushInterval is not a multiple of sampleInterval, pushing every " << ticksPerPush
+                     << " samples.\n";
+
+            std::unique_ptr<Summarizer> summarizer{};
+            if (ticksPerPush > 1)
+                summarizer = std::make_unique<Summarizer>(static_cast<std::size_t>(ticksPerPush) + 1);
+
+            // Pushes run on their own thread so a slow or unreachable server never shifts sample times.
+            InfluxPusher pusher{url, pushOptions};
+
+            // Ticks are aligned to the push interval on the wall clock, e.g. :00 and :30 for 30 seconds.
+            PeriodicTimer timer{samplePeriod, pushPeriod};
+            if (!timer.valid()) {
+                cerr << "Could not create sampling timer: " << std::strerror(errno) << '\n';
+                return 1;
+            }
 
-            // Build the influx data prefix
-            stringstream prefix{};
-            prefix << "sys,host=" << Hostname::name() << ' ';
-            if (cpuStats.getData())
-                cpuStats.setPastData();
+            // When a pressure trigger fires a sample is taken at once, and every sample is pushed as taken until
+            // burstDuration has passed without another trigger. Burst points carry a _burst field suffix so
+            // queries on the summary fields are not mixed with them. Only timer ticks are summarized, a trigger
+            // sample would crowd the ring and push the first samples of the interval out of the summary.
+            auto burstTicks = static_cast<std::uint64_t>(std::chrono::seconds{burstDuration} / samplePeriod);
+            std::uint64_t burstRemaining{0};
+            LineProtocol burstProtocol{};
+            burstProtocol.setFieldSuffix("_burst");
+            auto sampleBurst = [&](std::int64_t wallTime, bool tick) {
+                burstProtocol.clear();
+                burstProtocol.setTimestamp(wallTime / 1000000);
+                if (summarizer && tick) {
+                    TeeSink tee{*summarizer, burstProtocol};
+                    registry.sample(tee);
+                    summarizer->endSample();
+                } else {
+                    registry.sample(burstProtocol);
+                }
+                burstProtocol.finish();
+                if (!burstProtocol.empty())
+                    pusher.push(burstProtocol.data());
+            };
 
-            // Start the daemon process.
+            std::vector<pollfd> pollFds{{timer.fd(), POLLIN, 0}};
+            for (auto fd : registry.triggerFds())
+                pollFds.push_back({fd, POLLPRI, 0});
+
+            // Start the daemon process. A summary is pushed once a full push interval has been sampled.
+            std::uint64_t nextPush = summarizer ? ticksPerPush : 0;
             while (run) {
-                stringstream measurements{};
-                if (!cpuZone.empty()) {
-                    std::ifstream ifs;
-                    ifs.open(cpuZone, std::ofstream::in);
-                    if (ifs) {
-                        int temperature;
-                        ifs >> temperature;
-                        ifs.close();
-                        measurements << prefix.str() << "cpuTemp=" << temperature / 1000 << '\n';
+                if (::poll(pollFds.data(), pollFds.size(), -1) < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    cerr << "Poll failed: " << std::strerror(errno) << '\n';
+                    return 1;
+                }
+
+                bool triggered{false};
+                for (std::size_t idx = 1; idx < pollFds.size(); ++idx) {
+                    if (pollFds[idx].revents & POLLPRI) {
+                        triggered = true;
+                    } else if (pollFds[idx].revents & (POLLERR | POLLNVAL)) {
+                        cerr << "Pressure trigger failed, no longer polled.\n";
+                        pollFds[idx].fd = -1;
                     }
                 }
+                if (triggered) {
+                    if (burstRemaining == 0)
+                        cerr << "Pressure stall threshold crossed, reporting every sample.\n";
+                    burstRemaining = burstTicks;
+                    sampleBurst(PeriodicTimer::wallTime(), false);
+                }
 
-                if (cpuStats.getData()) {
-                    auto [used, idle] = cpuStats.getUsage();
-                    double percentUsage = 0.;
-                    if ((used + idle) != 0)
-                        percentUsage = 100.0 * static_cast<double>(used) / static_cast<double>(used + idle);
+                if (!(pollFds[0].revents & POLLIN))
+                    continue;
 
-                    measurements << prefix.str() << "cpuUse=" << percentUsage << '\n';
-                    cpuStats.setPastData();
+                auto tick = timer.wait();
+                if (!tick) {
+                    if (errno == EINTR || errno == EAGAIN)
+                        continue;
+                    cerr << "Sampling timer failed: " << std::strerror(errno) << '\n';
+                    return 1;
                 }
-
-                auto data = measurements.str();
-                if (!data.empty()) {
-                    try {
-                        cURLpp::Cleanup cleaner;
-                        cURLpp::Easy request;
-                        request.setOpt(new cURLpp::Options::Url(url.str()));
-                        request.setOpt(new curlpp::options::Verbose(false));
-
-                        std::list<std::string> header;
-                        header.emplace_back("Content-Type: application/octet-stream");
-                        request.setOpt(new curlpp::options::HttpHeader(header));
-
-                        request.setOpt(new curlpp::options::PostFieldSize(static_cast<long>(data.length())));
-                        request.setOpt(new curlpp::options::PostFields(data));
-
-                        request.perform();
-                    } catch (curlpp::LogicError &e) {
-                        std::cerr << e.what() << std::endl;
-                        return 1;
-                    } catch (curlpp::RuntimeError &e) {
-                        std::cerr << e.what() << std::endl;
-                        return 1;
+                if (tick->missed)
+                    cerr << "Sampling overran, " << tick->missed << " samples missed.\n";
+
+                bool pushNow = tick->index >= nextPush;
+                if (summarizer) {
+                    if (burstRemaining) {
+                        --burstRemaining;
+                        sampleBurst(tick->wallTime, true);
+                    } else {
+                        registry.sample(*summarizer);
+                        summarizer->endSample();
                     }
-                    sleep(30);
-                } else {
-                    cerr << "No active measurements, exiting\n";
-                    run = false;
+                    if (!pushNow)
+                        continue;
                 }
+
+                lineProtocol.clear();
+                lineProtocol.setTimestamp(tick->wallTime / 1000000);
+                if (summarizer)
+                    summarizer->summarize(lineProtocol);
+                else
+                    registry.sample(lineProtocol);
+                lineProtocol.finish();
+                nextPush = (tick->index / ticksPerPush + 1) * ticksPerPush;
+
+                if (!lineProtocol.empty())
+                    pusher.push(lineProtocol.data());
             }
         } else if (status == ConfigFile::NO_FILE) {
             cerr << "Configuration file specified " << configFilePath << " does not exist.\n";
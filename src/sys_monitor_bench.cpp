@@ -0,0 +1,74 @@
+//
+// Created by richard on 2021-09-12.
+//
+
+/**
+ * @file sys_monitor_bench.cpp
+ * @brief Measure the cost of one SYS_MONITOR sampling tick.
+ * @details Runs the sampling and encoding done by SYS_MONITOR every interval, without the push, and
+ * reports the mean time per tick and the number of heap allocations made during the timed ticks.
+ * Usage: SYS_MONITOR_BENCH [ticks] [thermal zone] [collectors]
+ */
+
+#include <iostream>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "unixstd.h"
+#include "Collector.h"
+#include "LineProtocol.h"
+
+static std::atomic_ulong allocations{0};
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (auto ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc{};
+}
+
+void operator delete(void *ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+int main(int argc, char **argv) {
+    static constexpr unsigned long WarmUpTicks = 10;
+
+    unsigned long ticks = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    CollectorConfig config{};
+    config.host = unixstd::Hostname::name();
+    config.cpuZone = argc > 2 ? std::strtol(argv[2], nullptr, 10) : 0;
+    config.filesystems.emplace_back("/");
+
+    CollectorRegistry registry{};
+    registry.addList(argc > 3 ? argv[3] : "cpu,temp,mem,disk,net,fs", config);
+    LineProtocol lineProtocol{};
+
+    auto tick = [&]() {
+        lineProtocol.clear();
+        registry.sample(lineProtocol);
+        lineProtocol.finish();
+    };
+
+    for (unsigned long i = 0; i < WarmUpTicks; ++i)
+        tick();
+
+    allocations = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < ticks; ++i)
+        tick();
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    auto allocated = allocations.load();
+
+    std::cout << lineProtocol.data()
+              << "ticks: " << ticks
+              << " mean: " << elapsed.count() / static_cast<double>(ticks) << " us/tick"
+              << " allocations: " << allocated << '\n';
+
+    return allocated == 0 ? 0 : 1;
+}